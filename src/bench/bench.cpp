@@ -17,6 +17,18 @@ static double gettimedouble(void) {
     return tv.tv_usec * 0.000001 + tv.tv_sec;
 }
 
+// Time stamp counter; on recent x86 CPUs it ticks at the nominal clock rate
+// whatever the current frequency. Returns 0 where no counter is available.
+static uint64_t getcycles(void) {
+#if defined(__i386__) || defined(__x86_64__) || defined(__amd64__)
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+#else
+    return 0;
+#endif
+}
+
 BenchRunner::BenchRunner(std::string name, BenchFunction func)
 {
     benchmarks.insert(std::make_pair(name, func));
@@ -25,7 +37,8 @@ BenchRunner::BenchRunner(std::string name, BenchFunction func)
 void
 BenchRunner::RunAll(double elapsedTimeForOne)
 {
-    std::cout << "Benchmark" << "," << "count" << "," << "min" << "," << "max" << "," << "average" << "\n";
+    std::cout << "Benchmark" << "," << "count" << "," << "min" << "," << "max" << "," << "average" << ","
+              << "cycles" << "," << "hashes/s" << "," << "cycles/byte" << "\n";
 
     for (std::map<std::string,BenchFunction>::iterator it = benchmarks.begin();
          it != benchmarks.end(); ++it) {
@@ -41,6 +54,7 @@ bool State::KeepRunning()
     double now;
     if (count == 0) {
         beginTime = now = gettimedouble();
+        beginCycles = getcycles();
     }
     else {
         // timeCheckCount is used to avoid calling gettime most of the time,
@@ -64,7 +78,11 @@ bool State::KeepRunning()
 
     // Output results
     double average = (now-beginTime)/count;
-    std::cout << name << "," << count << "," << minTime << "," << maxTime << "," << average << "\n";
+    double cycles = (double)(getcycles() - beginCycles)/count;
+    double hashRate = hashesPerIteration ? hashesPerIteration/average : 0;
+    double cyclesPerByte = bytesPerIteration ? cycles/bytesPerIteration : 0;
+    std::cout << name << "," << count << "," << minTime << "," << maxTime << "," << average << ","
+              << cycles << "," << hashRate << "," << cyclesPerByte << "\n";
 
     return false;
 }
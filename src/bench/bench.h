@@ -5,7 +5,9 @@
 #ifndef BITCOIN_BENCH_BENCH_H
 #define BITCOIN_BENCH_BENCH_H
 
+#include <limits>
 #include <map>
+#include <stdint.h>
 #include <string>
 
 #include <boost/function.hpp>
@@ -41,14 +43,23 @@ namespace benchmark {
         double maxElapsed;
         double beginTime;
         double lastTime, minTime, maxTime;
+        uint64_t beginCycles;
         int64_t count;
         int64_t timeCheckCount;
+        int64_t hashesPerIteration;
+        int64_t bytesPerIteration;
     public:
         State(std::string _name, double _maxElapsed) : name(_name), maxElapsed(_maxElapsed), count(0) {
             minTime = std::numeric_limits<double>::max();
             maxTime = std::numeric_limits<double>::min();
             timeCheckCount = 1;
+            hashesPerIteration = 0;
+            bytesPerIteration = 0;
         }
+        /** Number of hashes one iteration computes, for the hashes/s column */
+        void SetHashesPerIteration(int64_t hashes) { hashesPerIteration = hashes; }
+        /** Number of input bytes one iteration hashes, for the cycles/byte column */
+        void SetBytesPerIteration(int64_t bytes) { bytesPerIteration = bytes; }
         bool KeepRunning();
     };
 
@@ -4,6 +4,8 @@
 
 #include "bench.h"
 
+#include "crypto/sha256.h"
+#include "hashgeek.h"
 #include "key.h"
 #include "validation.h"
 #include "util.h"
@@ -14,6 +16,8 @@ main(int argc, char** argv)
     ECC_Start();
     SetupEnvironment();
     fPrintToDebugLog = false; // don't want to write to debug.log file
+    SHA256AutoDetect();
+    HashGeekAutoDetect();
 
     benchmark::BenchRunner::RunAll();
 
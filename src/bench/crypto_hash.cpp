@@ -0,0 +1,197 @@
+// Copyright (c) 2018 The GeekCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "consensus/merkle.h"
+#include "crypto/ripemd160.h"
+#include "crypto/sha256.h"
+#include "crypto/sph_jh.h"
+#include "crypto/sph_luffa.h"
+#include "crypto/sph_shavite.h"
+#include "crypto/sph_skein.h"
+#include "hash.h"
+#include "hashgeek.h"
+#include "hashx11.h"
+#include "uint256.h"
+
+#include <vector>
+
+/* Number of 80-byte headers hashed per iteration */
+static const size_t BENCH_HEADERS = 64;
+
+/* Size of the buffer the streaming hashers consume per iteration */
+static const size_t BENCH_BUFFER_SIZE = 1000 * 1000;
+
+/* Hash one 64-byte message per iteration, as the chained stages of HashGeek and X11 do */
+template<typename Context, void (*Init)(void*), void (*Update)(void*, const void*, size_t), void (*Close)(void*, void*)>
+static void SphHash512(benchmark::State& state)
+{
+    Context ctx;
+    unsigned char buf[64] = {0};
+    state.SetHashesPerIteration(1);
+    state.SetBytesPerIteration(sizeof(buf));
+    while (state.KeepRunning()) {
+        Init(&ctx);
+        Update(&ctx, buf, sizeof(buf));
+        Close(&ctx, buf);
+    }
+}
+
+#define BENCHMARK_SPH512(name, algo) \
+    static void name(benchmark::State& state) \
+    { \
+        SphHash512<sph_##algo##512_context, sph_##algo##512_init, sph_##algo##512, sph_##algo##512_close>(state); \
+    } \
+    BENCHMARK(name);
+
+BENCHMARK_SPH512(SPH_Blake512_64, blake)
+BENCHMARK_SPH512(SPH_Bmw512_64, bmw)
+BENCHMARK_SPH512(SPH_CubeHash512_64, cubehash)
+BENCHMARK_SPH512(SPH_Echo512_64, echo)
+BENCHMARK_SPH512(SPH_Groestl512_64, groestl)
+BENCHMARK_SPH512(SPH_Hamsi512_64, hamsi)
+BENCHMARK_SPH512(SPH_JH512_64, jh)
+BENCHMARK_SPH512(SPH_Keccak512_64, keccak)
+BENCHMARK_SPH512(SPH_Luffa512_64, luffa)
+BENCHMARK_SPH512(SPH_Shabal512_64, shabal)
+BENCHMARK_SPH512(SPH_Shavite512_64, shavite)
+BENCHMARK_SPH512(SPH_Simd512_64, simd)
+BENCHMARK_SPH512(SPH_Skein512_64, skein)
+
+static void HashGeekHeaders(benchmark::State& state)
+{
+    std::vector<unsigned char> in(BENCH_HEADERS * 80, 0);
+    std::vector<uint256> out(BENCH_HEADERS);
+    state.SetHashesPerIteration(BENCH_HEADERS);
+    state.SetBytesPerIteration(in.size());
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < BENCH_HEADERS; i++) {
+            out[i] = HashGeek(in.begin() + i * 80, in.begin() + (i + 1) * 80);
+        }
+        in[0]++;
+    }
+}
+
+static void HashGeekBatchHeaders(benchmark::State& state)
+{
+    std::vector<unsigned char> in(BENCH_HEADERS * 80, 0);
+    std::vector<uint256> out(BENCH_HEADERS);
+    state.SetHashesPerIteration(BENCH_HEADERS);
+    state.SetBytesPerIteration(in.size());
+    while (state.KeepRunning()) {
+        HashGeekBatch(&in[0], 80, BENCH_HEADERS, &out[0]);
+        in[0]++;
+    }
+}
+
+static void HashX11Headers(benchmark::State& state)
+{
+    std::vector<unsigned char> in(BENCH_HEADERS * 80, 0);
+    std::vector<uint256> out(BENCH_HEADERS);
+    state.SetHashesPerIteration(BENCH_HEADERS);
+    state.SetBytesPerIteration(in.size());
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < BENCH_HEADERS; i++) {
+            out[i] = HashX11(in.begin() + i * 80, in.begin() + (i + 1) * 80);
+        }
+        in[0]++;
+    }
+}
+
+static void SHA256_1M(benchmark::State& state)
+{
+    std::vector<unsigned char> in(BENCH_BUFFER_SIZE, 0);
+    uint8_t hash[CSHA256::OUTPUT_SIZE];
+    state.SetHashesPerIteration(1);
+    state.SetBytesPerIteration(in.size());
+    while (state.KeepRunning()) {
+        CSHA256().Write(&in[0], in.size()).Finalize(hash);
+    }
+}
+
+static void CHash256_1M(benchmark::State& state)
+{
+    std::vector<unsigned char> in(BENCH_BUFFER_SIZE, 0);
+    uint8_t hash[CHash256::OUTPUT_SIZE];
+    state.SetHashesPerIteration(1);
+    state.SetBytesPerIteration(in.size());
+    while (state.KeepRunning()) {
+        CHash256().Write(&in[0], in.size()).Finalize(hash);
+    }
+}
+
+static void RIPEMD160_1M(benchmark::State& state)
+{
+    std::vector<unsigned char> in(BENCH_BUFFER_SIZE, 0);
+    uint8_t hash[CRIPEMD160::OUTPUT_SIZE];
+    state.SetHashesPerIteration(1);
+    state.SetBytesPerIteration(in.size());
+    while (state.KeepRunning()) {
+        CRIPEMD160().Write(&in[0], in.size()).Finalize(hash);
+    }
+}
+
+/* Number of 64-byte blobs double-hashed per iteration */
+static const size_t BENCH_BLOBS = 1024;
+
+static void SHA256D64_1024(benchmark::State& state)
+{
+    std::vector<unsigned char> in(BENCH_BLOBS * 64, 0);
+    std::vector<unsigned char> out(BENCH_BLOBS * 32);
+    state.SetHashesPerIteration(BENCH_BLOBS);
+    state.SetBytesPerIteration(in.size());
+    while (state.KeepRunning()) {
+        SHA256D64(&out[0], &in[0], BENCH_BLOBS);
+        in[0] = out[0];
+    }
+}
+
+static void CHash256_64_1024(benchmark::State& state)
+{
+    std::vector<unsigned char> in(BENCH_BLOBS * 64, 0);
+    std::vector<unsigned char> out(BENCH_BLOBS * 32);
+    state.SetHashesPerIteration(BENCH_BLOBS);
+    state.SetBytesPerIteration(in.size());
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < BENCH_BLOBS; i++) {
+            CHash256().Write(&in[64 * i], 64).Finalize(&out[32 * i]);
+        }
+        in[0] = out[0];
+    }
+}
+
+/* Merkle root of a block with the given number of transactions; a tree of n leaves hashes about n pairs */
+static void MerkleRoot(benchmark::State& state, size_t nLeaves)
+{
+    std::vector<uint256> leaves(nLeaves);
+    for (size_t i = 0; i < nLeaves; i++) {
+        CHash256().Write((const unsigned char*)&i, sizeof(i)).Finalize(leaves[i].begin());
+    }
+    state.SetHashesPerIteration(nLeaves);
+    state.SetBytesPerIteration(nLeaves * 32);
+    while (state.KeepRunning()) {
+        bool mutated;
+        uint256 root = ComputeMerkleRoot(leaves, &mutated);
+        leaves[0] = root;
+    }
+}
+
+static void MerkleRoot_10(benchmark::State& state) { MerkleRoot(state, 10); }
+static void MerkleRoot_100(benchmark::State& state) { MerkleRoot(state, 100); }
+static void MerkleRoot_1000(benchmark::State& state) { MerkleRoot(state, 1000); }
+static void MerkleRoot_10000(benchmark::State& state) { MerkleRoot(state, 10000); }
+
+BENCHMARK(HashGeekHeaders);
+BENCHMARK(HashGeekBatchHeaders);
+BENCHMARK(HashX11Headers);
+BENCHMARK(SHA256_1M);
+BENCHMARK(CHash256_1M);
+BENCHMARK(RIPEMD160_1M);
+BENCHMARK(SHA256D64_1024);
+BENCHMARK(CHash256_64_1024);
+BENCHMARK(MerkleRoot_10);
+BENCHMARK(MerkleRoot_100);
+BENCHMARK(MerkleRoot_1000);
+BENCHMARK(MerkleRoot_10000);
@@ -16,6 +16,18 @@ uint256 ComputeMerkleRoot(const std::vector<uint256>& leaves, bool* mutated = NU
 std::vector<uint256> ComputeMerkleBranch(const std::vector<uint256>& leaves, uint32_t position);
 uint256 ComputeMerkleRootFromBranch(const uint256& leaf, const std::vector<uint256>& branch, uint32_t position);
 
+/*
+ * Compute the Merkle root and the branch for a given position in one pass
+ * over the tree, rather than hashing it twice.
+ */
+uint256 ComputeMerkleRootAndBranch(const std::vector<uint256>& leaves, uint32_t position, std::vector<uint256>& branch, bool* mutated = NULL);
+
+/*
+ * Compute every level of the Merkle tree: the first entry holds the leaves
+ * and the last one the root. Entry h has one hash per node at height h.
+ */
+std::vector<std::vector<uint256> > ComputeMerkleLevels(const std::vector<uint256>& leaves);
+
 /*
  * Compute the Merkle root of the transactions in a block.
  * *mutated is set to true if a duplicated subtree was found.
@@ -29,4 +41,10 @@ uint256 BlockMerkleRoot(const CBlock& block, bool* mutated = NULL);
  */
 std::vector<uint256> BlockMerkleBranch(const CBlock& block, uint32_t position);
 
+/*
+ * Compute the Merkle root of the transactions in a block together with the
+ * branch for a given position, e.g. the coinbase branch a miner needs.
+ */
+uint256 BlockMerkleRootAndBranch(const CBlock& block, uint32_t position, std::vector<uint256>& branch, bool* mutated = NULL);
+
 #endif
@@ -0,0 +1,92 @@
+// Copyright (c) 2018 The GeekCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This is an AES-NI implementation of the ECHO-512 stage of HashGeek. ECHO
+// is built from two AES rounds on each of its sixteen 128-bit state words,
+// which map one-to-one onto the AESENC instruction, so each message is
+// processed on its own rather than across lanes. Only the 64-byte
+// intermediate input is supported.
+
+#ifdef ENABLE_AESNI
+
+#include <stdint.h>
+#include <emmintrin.h>
+#include <wmmintrin.h>
+
+namespace hashgeek_aesni {
+namespace {
+
+/** Multiply each byte by 2 in GF(2^8), modulo the AES polynomial. */
+__m128i inline Mul2(__m128i x)
+{
+    const __m128i carry = _mm_cmpgt_epi8(_mm_setzero_si128(), x);
+    return _mm_xor_si128(_mm_add_epi8(x, x), _mm_and_si128(carry, _mm_set1_epi8(0x1B)));
+}
+
+void inline MixColumn(__m128i* w, int i)
+{
+    const __m128i a = w[i], b = w[i + 1], c = w[i + 2], d = w[i + 3];
+    const __m128i ab = _mm_xor_si128(a, b), bc = _mm_xor_si128(b, c), cd = _mm_xor_si128(c, d);
+    const __m128i abx = Mul2(ab), bcx = Mul2(bc), cdx = Mul2(cd);
+    w[i] = _mm_xor_si128(abx, _mm_xor_si128(bc, d));
+    w[i + 1] = _mm_xor_si128(bcx, _mm_xor_si128(a, cd));
+    w[i + 2] = _mm_xor_si128(cdx, _mm_xor_si128(ab, d));
+    w[i + 3] = _mm_xor_si128(_mm_xor_si128(abx, bcx), _mm_xor_si128(_mm_xor_si128(cdx, ab), c));
+}
+
+void Echo512_64(unsigned char* out, const unsigned char* in)
+{
+    // Chaining value: the output length in each word. Message block: the
+    // input, the padding byte, the output length and the 512-bit counter.
+    const __m128i iv = _mm_set_epi64x(0, 512);
+    __m128i w[16], m[8];
+    for (int i = 0; i < 4; i++) m[i] = _mm_loadu_si128((const __m128i*)(in + 16 * i));
+    m[4] = _mm_set_epi32(0, 0, 0, 0x80);
+    m[5] = _mm_setzero_si128();
+    m[6] = _mm_set_epi16(512, 0, 0, 0, 0, 0, 0, 0);
+    m[7] = _mm_set_epi32(0, 0, 0, 512);
+    for (int i = 0; i < 8; i++) {
+        w[i] = iv;
+        w[i + 8] = m[i];
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t k = 512;
+    for (int round = 0; round < 10; round++) {
+        // Sub words: two AES rounds per word, the first keyed with the counter.
+        for (int i = 0; i < 16; i++) {
+            w[i] = _mm_aesenc_si128(_mm_aesenc_si128(w[i], _mm_cvtsi32_si128(k++)), zero);
+        }
+        // Shift rows.
+        __m128i t = w[1];
+        w[1] = w[5]; w[5] = w[9]; w[9] = w[13]; w[13] = t;
+        t = w[2]; w[2] = w[10]; w[10] = t;
+        t = w[6]; w[6] = w[14]; w[14] = t;
+        t = w[15];
+        w[15] = w[11]; w[11] = w[7]; w[7] = w[3]; w[3] = t;
+        // Mix columns.
+        MixColumn(w, 0);
+        MixColumn(w, 4);
+        MixColumn(w, 8);
+        MixColumn(w, 12);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        const __m128i v = _mm_xor_si128(_mm_xor_si128(iv, m[i]), _mm_xor_si128(w[i], w[i + 8]));
+        _mm_storeu_si128((__m128i*)(out + 16 * i), v);
+    }
+}
+
+} // namespace
+
+void Echo512_64_4way(unsigned char* out, const unsigned char* in)
+{
+    for (int lane = 0; lane < 4; lane++) {
+        Echo512_64(out + 64 * lane, in + 64 * lane);
+    }
+}
+
+} // namespace hashgeek_aesni
+
+#endif
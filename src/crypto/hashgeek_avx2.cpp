@@ -0,0 +1,349 @@
+// Copyright (c) 2018 The GeekCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This is a 4-way SIMD implementation of the BLAKE-512, BMW-512 and
+// Keccak-512 stages of HashGeek, each lane holding one 64-bit word of an
+// independent message. Only single-block messages are supported, which
+// covers both the 80-byte block header input of BLAKE-512 and the 64-byte
+// intermediate input of the other stages.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+#include "crypto/common.h"
+
+namespace hashgeek_avx2 {
+namespace {
+
+template<int n> __m256i inline Rotr(__m256i x) { return _mm256_or_si256(_mm256_srli_epi64(x, n), _mm256_slli_epi64(x, 64 - n)); }
+template<int n> __m256i inline Rotl(__m256i x) { return _mm256_or_si256(_mm256_slli_epi64(x, n), _mm256_srli_epi64(x, 64 - n)); }
+template<> __m256i inline Rotr<32>(__m256i x) { return _mm256_shuffle_epi32(x, 0xB1); }
+template<> __m256i inline Rotr<16>(__m256i x)
+{
+    return _mm256_shuffle_epi8(x, _mm256_set_epi8(9, 8, 15, 14, 13, 12, 11, 10, 1, 0, 7, 6, 5, 4, 3, 2,
+                                                  9, 8, 15, 14, 13, 12, 11, 10, 1, 0, 7, 6, 5, 4, 3, 2));
+}
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi64(x, y); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline K(uint64_t x) { return _mm256_set1_epi64x(x); }
+
+__m256i inline Sub(__m256i x, __m256i y) { return _mm256_sub_epi64(x, y); }
+__m256i inline Shl(__m256i x, int n) { return _mm256_sll_epi64(x, _mm_cvtsi32_si128(n)); }
+__m256i inline Shr(__m256i x, int n) { return _mm256_srl_epi64(x, _mm_cvtsi32_si128(n)); }
+__m256i inline RotlVar(__m256i x, int n) { return n == 0 ? x : _mm256_or_si256(Shl(x, n), Shr(x, 64 - n)); }
+
+/** Call f(0) .. f(N - 1), unrolled so that f sees constant indices. */
+template<int N> struct Repeat
+{
+    template<typename F> static void inline Run(const F& f) { Repeat<N - 1>::Run(f); f(N - 1); }
+};
+template<> struct Repeat<0>
+{
+    template<typename F> static void inline Run(const F&) {}
+};
+
+/** Load 64-bit word i of four consecutive 64-byte messages. */
+__m256i inline Read4(const unsigned char* in, int i)
+{
+    return _mm256_set_epi64x(ReadLE64(in + 192 + 8 * i), ReadLE64(in + 128 + 8 * i), ReadLE64(in + 64 + 8 * i), ReadLE64(in + 8 * i));
+}
+
+/** Store 64-bit words 0 .. n - 1 of four consecutive 64-byte digests. */
+void inline Write4(unsigned char* out, const __m256i* v, int n)
+{
+    alignas(32) uint64_t w[4];
+    for (int i = 0; i < n; i++) {
+        _mm256_store_si256((__m256i*)w, v[i]);
+        for (int lane = 0; lane < 4; lane++) {
+            WriteLE64(out + 64 * lane + 8 * i, w[lane]);
+        }
+    }
+}
+
+__m256i inline Gather(const uint64_t* w, int i) { return _mm256_set_epi64x(w[48 + i], w[32 + i], w[16 + i], w[i]); }
+
+/// BLAKE-512 constants.
+namespace blake {
+
+const uint64_t IV[8] = {
+    0x6A09E667F3BCC908ull, 0xBB67AE8584CAA73Bull, 0x3C6EF372FE94F82Bull, 0xA54FF53A5F1D36F1ull,
+    0x510E527FADE682D1ull, 0x9B05688C2B3E6C1Full, 0x1F83D9ABFB41BD6Bull, 0x5BE0CD19137E2179ull
+};
+
+const uint64_t C[16] = {
+    0x243F6A8885A308D3ull, 0x13198A2E03707344ull, 0xA4093822299F31D0ull, 0x082EFA98EC4E6C89ull,
+    0x452821E638D01377ull, 0xBE5466CF34E90C6Cull, 0xC0AC29B7C97C50DDull, 0x3F84D5B5B5470917ull,
+    0x9216D5D98979FB1Bull, 0xD1310BA698DFB5ACull, 0x2FFD72DBD01ADFB7ull, 0xB8E1AFED6A267E96ull,
+    0xBA7C9045F12C7F99ull, 0x24A19947B3916CF7ull, 0x0801F2E2858EFC16ull, 0x636920D871574E69ull
+};
+
+const unsigned char SIGMA[10][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+};
+
+void inline G(const __m256i* m, const unsigned char* s, __m256i& a, __m256i& b, __m256i& c, __m256i& d)
+{
+    a = Add(Add(a, b), Xor(m[s[0]], K(C[s[1]])));
+    d = Rotr<32>(Xor(d, a));
+    c = Add(c, d);
+    b = Rotr<25>(Xor(b, c));
+    a = Add(Add(a, b), Xor(m[s[1]], K(C[s[0]])));
+    d = Rotr<16>(Xor(d, a));
+    c = Add(c, d);
+    b = Rotr<11>(Xor(b, c));
+}
+
+} // namespace blake
+
+/// BMW-512 constants and compression function.
+namespace bmw {
+
+const uint64_t IV[16] = {
+    0x8081828384858687ull, 0x88898A8B8C8D8E8Full, 0x9091929394959697ull, 0x98999A9B9C9D9E9Full,
+    0xA0A1A2A3A4A5A6A7ull, 0xA8A9AAABACADAEAFull, 0xB0B1B2B3B4B5B6B7ull, 0xB8B9BABBBCBDBEBFull,
+    0xC0C1C2C3C4C5C6C7ull, 0xC8C9CACBCCCDCECFull, 0xD0D1D2D3D4D5D6D7ull, 0xD8D9DADBDCDDDEDFull,
+    0xE0E1E2E3E4E5E6E7ull, 0xE8E9EAEBECEDEEEFull, 0xF0F1F2F3F4F5F6F7ull, 0xF8F9FAFBFCFDFEFFull
+};
+
+const uint64_t FINAL[16] = {
+    0xaaaaaaaaaaaaaaa0ull, 0xaaaaaaaaaaaaaaa1ull, 0xaaaaaaaaaaaaaaa2ull, 0xaaaaaaaaaaaaaaa3ull,
+    0xaaaaaaaaaaaaaaa4ull, 0xaaaaaaaaaaaaaaa5ull, 0xaaaaaaaaaaaaaaa6ull, 0xaaaaaaaaaaaaaaa7ull,
+    0xaaaaaaaaaaaaaaa8ull, 0xaaaaaaaaaaaaaaa9ull, 0xaaaaaaaaaaaaaaaaull, 0xaaaaaaaaaaaaaaabull,
+    0xaaaaaaaaaaaaaaacull, 0xaaaaaaaaaaaaaaadull, 0xaaaaaaaaaaaaaaaeull, 0xaaaaaaaaaaaaaaafull
+};
+
+/** Terms of W[i]: the five indices j of (M[j] ^ H[j]), and whether each of the last four is subtracted. */
+const int W_INDEX[16][5] = {
+    {  5,  7, 10, 13, 14 }, {  6,  8, 11, 14, 15 }, {  0,  7,  9, 12, 15 }, {  0,  1,  8, 10, 13 },
+    {  1,  2,  9, 11, 14 }, {  3,  2, 10, 12, 15 }, {  4,  0,  3, 11, 13 }, {  1,  4,  5, 12, 14 },
+    {  2,  5,  6, 13, 15 }, {  0,  3,  6,  7, 14 }, {  8,  1,  4,  7, 15 }, {  8,  0,  2,  5,  9 },
+    {  1,  3,  6,  9, 10 }, {  2,  4,  7, 10, 11 }, {  3,  5,  8, 11, 12 }, { 12,  4,  6,  9, 13 }
+};
+const bool W_SUB[16][4] = {
+    { 1, 0, 0, 0 }, { 1, 0, 0, 1 }, { 0, 0, 1, 0 }, { 1, 0, 1, 0 },
+    { 0, 0, 1, 1 }, { 1, 0, 1, 0 }, { 1, 1, 1, 0 }, { 1, 1, 1, 1 },
+    { 1, 1, 0, 1 }, { 1, 0, 1, 0 }, { 1, 1, 1, 0 }, { 1, 1, 1, 0 },
+    { 0, 1, 1, 0 }, { 0, 0, 0, 0 }, { 1, 0, 1, 1 }, { 1, 1, 1, 0 }
+};
+
+/** The s0 .. s5 functions; s4 and s5 have no rotations. */
+const int S_SHR[6] = { 1, 1, 2, 2, 1, 2 };
+const int S_SHL[4] = { 3, 2, 1, 2 };
+const int S_ROT1[4] = { 4, 13, 19, 28 };
+const int S_ROT2[4] = { 37, 43, 53, 59 };
+
+/** Rotations of the odd-indexed terms in expand2. */
+const int R_ROT[7] = { 5, 11, 27, 32, 37, 43, 53 };
+
+__m256i inline S(int k, __m256i x)
+{
+    if (k >= 4) return Xor(Shr(x, S_SHR[k]), x);
+    return Xor(Xor(Shr(x, S_SHR[k]), Shl(x, S_SHL[k])), Xor(RotlVar(x, S_ROT1[k]), RotlVar(x, S_ROT2[k])));
+}
+
+__m256i inline AddElt(const __m256i* m, const __m256i* h, int j)
+{
+    __m256i t = Add(RotlVar(m[j], j + 1), RotlVar(m[(j + 3) & 15], ((j + 3) & 15) + 1));
+    t = Sub(t, RotlVar(m[(j + 10) & 15], ((j + 10) & 15) + 1));
+    return Xor(Add(t, K((uint64_t)(j + 16) * 0x0555555555555555ull)), h[(j + 7) & 15]);
+}
+
+void inline Compress(const __m256i* m, const __m256i* h, __m256i* dh)
+{
+    __m256i q[32];
+    Repeat<16>::Run([m, h, &q](int i) {
+        const int* idx = W_INDEX[i];
+        __m256i w = Xor(m[idx[0]], h[idx[0]]);
+        Repeat<4>::Run([m, h, i, idx, &w](int k) {
+            __m256i t = Xor(m[idx[k + 1]], h[idx[k + 1]]);
+            w = W_SUB[i][k] ? Sub(w, t) : Add(w, t);
+        });
+        q[i] = Add(S(i % 5, w), h[(i + 1) & 15]);
+    });
+    Repeat<2>::Run([m, h, &q](int u) {
+        __m256i t = AddElt(m, h, u);
+        Repeat<16>::Run([u, &q, &t](int k) { t = Add(t, S((k + 1) & 3, q[u + k])); });
+        q[16 + u] = t;
+    });
+    Repeat<14>::Run([m, h, &q](int v) {
+        const int u = v + 2;
+        __m256i t = Add(AddElt(m, h, u), Add(S(4, q[u + 14]), S(5, q[u + 15])));
+        Repeat<7>::Run([u, &q, &t](int k) { t = Add(t, Add(q[u + 2 * k], RotlVar(q[u + 2 * k + 1], R_ROT[k]))); });
+        q[16 + u] = t;
+    });
+
+    __m256i xl = q[16], xh;
+    for (int i = 17; i < 24; i++) xl = Xor(xl, q[i]);
+    xh = xl;
+    for (int i = 24; i < 32; i++) xh = Xor(xh, q[i]);
+
+    dh[0] = Add(Xor(Xor(Shl(xh, 5), Shr(q[16], 5)), m[0]), Xor(Xor(xl, q[24]), q[0]));
+    dh[1] = Add(Xor(Xor(Shr(xh, 7), Shl(q[17], 8)), m[1]), Xor(Xor(xl, q[25]), q[1]));
+    dh[2] = Add(Xor(Xor(Shr(xh, 5), Shl(q[18], 5)), m[2]), Xor(Xor(xl, q[26]), q[2]));
+    dh[3] = Add(Xor(Xor(Shr(xh, 1), Shl(q[19], 5)), m[3]), Xor(Xor(xl, q[27]), q[3]));
+    dh[4] = Add(Xor(Xor(Shr(xh, 3), q[20]), m[4]), Xor(Xor(xl, q[28]), q[4]));
+    dh[5] = Add(Xor(Xor(Shl(xh, 6), Shr(q[21], 6)), m[5]), Xor(Xor(xl, q[29]), q[5]));
+    dh[6] = Add(Xor(Xor(Shr(xh, 4), Shl(q[22], 6)), m[6]), Xor(Xor(xl, q[30]), q[6]));
+    dh[7] = Add(Xor(Xor(Shr(xh, 11), Shl(q[23], 2)), m[7]), Xor(Xor(xl, q[31]), q[7]));
+    dh[8] = Add(Add(RotlVar(dh[4], 9), Xor(Xor(xh, q[24]), m[8])), Xor(Xor(Shl(xl, 8), q[23]), q[8]));
+    dh[9] = Add(Add(RotlVar(dh[5], 10), Xor(Xor(xh, q[25]), m[9])), Xor(Xor(Shr(xl, 6), q[16]), q[9]));
+    dh[10] = Add(Add(RotlVar(dh[6], 11), Xor(Xor(xh, q[26]), m[10])), Xor(Xor(Shl(xl, 6), q[17]), q[10]));
+    dh[11] = Add(Add(RotlVar(dh[7], 12), Xor(Xor(xh, q[27]), m[11])), Xor(Xor(Shl(xl, 4), q[18]), q[11]));
+    dh[12] = Add(Add(RotlVar(dh[0], 13), Xor(Xor(xh, q[28]), m[12])), Xor(Xor(Shr(xl, 3), q[19]), q[12]));
+    dh[13] = Add(Add(RotlVar(dh[1], 14), Xor(Xor(xh, q[29]), m[13])), Xor(Xor(Shr(xl, 4), q[20]), q[13]));
+    dh[14] = Add(Add(RotlVar(dh[2], 15), Xor(Xor(xh, q[30]), m[14])), Xor(Xor(Shr(xl, 7), q[21]), q[14]));
+    dh[15] = Add(Add(RotlVar(dh[3], 16), Xor(Xor(xh, q[31]), m[15])), Xor(Xor(Shr(xl, 2), q[22]), q[15]));
+}
+
+} // namespace bmw
+
+/// Keccak-f[1600] constants.
+namespace keccak {
+
+const uint64_t RC[24] = {
+    0x0000000000000001ull, 0x0000000000008082ull, 0x800000000000808Aull, 0x8000000080008000ull,
+    0x000000000000808Bull, 0x0000000080000001ull, 0x8000000080008081ull, 0x8000000000008009ull,
+    0x000000000000008Aull, 0x0000000000000088ull, 0x0000000080008009ull, 0x000000008000000Aull,
+    0x000000008000808Bull, 0x800000000000008Bull, 0x8000000000008089ull, 0x8000000000008003ull,
+    0x8000000000008002ull, 0x8000000000000080ull, 0x000000000000800Aull, 0x800000008000000Aull,
+    0x8000000080008081ull, 0x8000000000008080ull, 0x0000000080000001ull, 0x8000000080008008ull
+};
+
+/** Rotation offsets, indexed by x + 5 * y. */
+const int RHO[25] = {
+     0,  1, 62, 28, 27,
+    36, 44,  6, 55, 20,
+     3, 10, 43, 25, 39,
+    41, 45, 15, 21,  8,
+    18,  2, 61, 56, 14
+};
+
+void Permute(__m256i* a)
+{
+    __m256i b[25], c[5], d[5];
+    for (int round = 0; round < 24; round++) {
+        // Theta
+        Repeat<5>::Run([a, &c](int x) { c[x] = Xor(Xor(Xor(a[x], a[x + 5]), Xor(a[x + 10], a[x + 15])), a[x + 20]); });
+        Repeat<5>::Run([c, &d](int x) { d[x] = Xor(c[(x + 4) % 5], Rotl<1>(c[(x + 1) % 5])); });
+        Repeat<25>::Run([a, d](int i) { a[i] = Xor(a[i], d[i % 5]); });
+        // Rho and pi
+        Repeat<25>::Run([a, &b](int i) { b[i / 5 + 5 * ((2 * (i % 5) + 3 * (i / 5)) % 5)] = RotlVar(a[i], RHO[i]); });
+        // Chi
+        Repeat<25>::Run([a, b](int i) { a[i] = Xor(b[i], _mm256_andnot_si256(b[i - i % 5 + (i + 1) % 5], b[i - i % 5 + (i + 2) % 5])); });
+        // Iota
+        a[0] = Xor(a[0], K(RC[round]));
+    }
+}
+
+} // namespace keccak
+
+} // namespace
+
+void Blake512_4way(unsigned char* out, const unsigned char* in, size_t len)
+{
+    // Build the padded final (and only) block for each message, as 64-bit
+    // big endian words, with the message length in bits as counter.
+    uint64_t w[64];
+    for (int lane = 0; lane < 4; lane++) {
+        unsigned char block[128] = {0};
+        memcpy(block, in + lane * len, len);
+        block[len] = 0x80;
+        block[111] |= 0x01;
+        WriteBE64(block + 120, (uint64_t)len << 3);
+        for (int i = 0; i < 16; i++) {
+            w[16 * lane + i] = ReadBE64(block + 8 * i);
+        }
+    }
+
+    __m256i m[16];
+    for (int i = 0; i < 16; i++) {
+        m[i] = Gather(w, i);
+    }
+
+    const uint64_t bits = (uint64_t)len << 3;
+    __m256i v0 = K(blake::IV[0]), v1 = K(blake::IV[1]), v2 = K(blake::IV[2]), v3 = K(blake::IV[3]);
+    __m256i v4 = K(blake::IV[4]), v5 = K(blake::IV[5]), v6 = K(blake::IV[6]), v7 = K(blake::IV[7]);
+    __m256i v8 = K(blake::C[0]), v9 = K(blake::C[1]), va = K(blake::C[2]), vb = K(blake::C[3]);
+    __m256i vc = K(bits ^ blake::C[4]), vd = K(bits ^ blake::C[5]), ve = K(blake::C[6]), vf = K(blake::C[7]);
+
+    Repeat<16>::Run([&](int r) {
+        const unsigned char* s = blake::SIGMA[r % 10];
+        blake::G(m, s + 0x0, v0, v4, v8, vc);
+        blake::G(m, s + 0x2, v1, v5, v9, vd);
+        blake::G(m, s + 0x4, v2, v6, va, ve);
+        blake::G(m, s + 0x6, v3, v7, vb, vf);
+        blake::G(m, s + 0x8, v0, v5, va, vf);
+        blake::G(m, s + 0xA, v1, v6, vb, vc);
+        blake::G(m, s + 0xC, v2, v7, v8, vd);
+        blake::G(m, s + 0xE, v3, v4, v9, ve);
+    });
+
+    __m256i h[8];
+    h[0] = Xor(K(blake::IV[0]), Xor(v0, v8));
+    h[1] = Xor(K(blake::IV[1]), Xor(v1, v9));
+    h[2] = Xor(K(blake::IV[2]), Xor(v2, va));
+    h[3] = Xor(K(blake::IV[3]), Xor(v3, vb));
+    h[4] = Xor(K(blake::IV[4]), Xor(v4, vc));
+    h[5] = Xor(K(blake::IV[5]), Xor(v5, vd));
+    h[6] = Xor(K(blake::IV[6]), Xor(v6, ve));
+    h[7] = Xor(K(blake::IV[7]), Xor(v7, vf));
+
+    alignas(32) uint64_t res[8][4];
+    for (int i = 0; i < 8; i++) {
+        _mm256_store_si256((__m256i*)res[i], h[i]);
+    }
+    for (int lane = 0; lane < 4; lane++) {
+        for (int i = 0; i < 8; i++) {
+            WriteBE64(out + 64 * lane + 8 * i, res[i][lane]);
+        }
+    }
+}
+
+void Bmw512_64_4way(unsigned char* out, const unsigned char* in)
+{
+    // The message and its padding fit in one 128-byte block, followed by
+    // the final compression with the constant chaining value.
+    __m256i m[16], h[16], dh[16];
+    for (int i = 0; i < 8; i++) m[i] = Read4(in, i);
+    m[8] = K(0x80);
+    for (int i = 9; i < 15; i++) m[i] = _mm256_setzero_si256();
+    m[15] = K(512);
+    for (int i = 0; i < 16; i++) h[i] = K(bmw::IV[i]);
+    bmw::Compress(m, h, dh);
+
+    for (int i = 0; i < 16; i++) h[i] = K(bmw::FINAL[i]);
+    bmw::Compress(dh, h, m);
+    Write4(out, m + 8, 8);
+}
+
+void Keccak512_64_4way(unsigned char* out, const unsigned char* in)
+{
+    // A 64-byte message fits in the 72-byte rate of Keccak-512, leaving
+    // room for the padding in lane 8.
+    __m256i a[25];
+    for (int i = 0; i < 8; i++) a[i] = Read4(in, i);
+    a[8] = K(0x8000000000000001ull);
+    for (int i = 9; i < 25; i++) {
+        a[i] = _mm256_setzero_si256();
+    }
+
+    keccak::Permute(a);
+    Write4(out, a, 8);
+}
+
+} // namespace hashgeek_avx2
+
+#endif
@@ -0,0 +1,345 @@
+// Copyright (c) 2018 The GeekCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This is a 4-way SIMD implementation of the Shabal-512, CubeHash-512 and
+// Hamsi-512 stages of HashGeek, each lane holding one 32-bit word of an
+// independent message. They operate on the 64-byte intermediate hashes only.
+// SSE2 is part of the x86-64 baseline, so these are available on every
+// 64-bit x86 CPU, with or without AVX2.
+
+#if defined(__SSE2__)
+
+#include <stdint.h>
+#include <emmintrin.h>
+
+#include "crypto/common.h"
+#include "crypto/sph_hamsi.h"
+
+namespace hashgeek_sse2 {
+namespace {
+
+template<int n> __m128i inline Rotl(__m128i x) { return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n)); }
+__m128i inline Add(__m128i x, __m128i y) { return _mm_add_epi32(x, y); }
+__m128i inline Sub(__m128i x, __m128i y) { return _mm_sub_epi32(x, y); }
+__m128i inline Xor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+__m128i inline And(__m128i x, __m128i y) { return _mm_and_si128(x, y); }
+__m128i inline Or(__m128i x, __m128i y) { return _mm_or_si128(x, y); }
+__m128i inline K(uint32_t x) { return _mm_set1_epi32(x); }
+
+/** Load word i of four consecutive 64-byte messages. */
+__m128i inline Read4(const unsigned char* in, int i)
+{
+    return _mm_set_epi32(ReadLE32(in + 192 + 4 * i), ReadLE32(in + 128 + 4 * i), ReadLE32(in + 64 + 4 * i), ReadLE32(in + 4 * i));
+}
+
+/** Store word i of four consecutive 64-byte digests. */
+void inline Write4(unsigned char* out, int i, __m128i v)
+{
+    alignas(16) uint32_t w[4];
+    _mm_store_si128((__m128i*)w, v);
+    for (int lane = 0; lane < 4; lane++) {
+        WriteLE32(out + 64 * lane + 4 * i, w[lane]);
+    }
+}
+
+/** Call f(0) .. f(N - 1), unrolled so that f sees constant indices. */
+template<int N> struct Repeat
+{
+    template<typename F> static void inline Run(const F& f) { Repeat<N - 1>::Run(f); f(N - 1); }
+};
+template<> struct Repeat<0>
+{
+    template<typename F> static void inline Run(const F&) {}
+};
+
+/** Transpose a 4x4 matrix of 32-bit words held in four registers. */
+void inline Transpose(__m128i& r0, __m128i& r1, __m128i& r2, __m128i& r3)
+{
+    const __m128i t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpacklo_epi32(r2, r3);
+    const __m128i t2 = _mm_unpackhi_epi32(r0, r1), t3 = _mm_unpackhi_epi32(r2, r3);
+    r0 = _mm_unpacklo_epi64(t0, t1);
+    r1 = _mm_unpackhi_epi64(t0, t1);
+    r2 = _mm_unpacklo_epi64(t2, t3);
+    r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+void inline Swap(__m128i& x, __m128i& y)
+{
+    __m128i t = x;
+    x = y;
+    y = t;
+}
+
+/// Shabal-512 constants and permutation.
+namespace shabal {
+
+const uint32_t A_INIT[12] = {
+    0x20728DFD, 0x46C0BD53, 0xE782B699, 0x55304632, 0x71B4EF90, 0x0EA9E82C,
+    0xDBB930F1, 0xFAD06B8B, 0xBE0CAE40, 0x8BD14410, 0x76D2ADAC, 0x28ACAB7F
+};
+
+const uint32_t B_INIT[16] = {
+    0xC1099CB7, 0x07B385F3, 0xE7442C26, 0xCC8AD640, 0xEB6F56C7, 0x1EA81AA9, 0x73B9D314, 0x1DE85D08,
+    0x48910A5A, 0x893B22DB, 0xC5A0DF44, 0xBBC4324E, 0x72D2F240, 0x75941D99, 0x6D8BDE82, 0xA1A7502B
+};
+
+const uint32_t C_INIT[16] = {
+    0xD9BF68D1, 0x58BAD750, 0x56028CB2, 0x8134F359, 0xB5D469D8, 0x941A8CC2, 0x418B2A6E, 0x04052780,
+    0x7F07D787, 0x5194358F, 0x3C60D665, 0xBE97D79A, 0x950C3434, 0xAED9A06D, 0x2537DC8D, 0x7CDB5969
+};
+
+void inline Permute(__m128i* a, __m128i* b, const __m128i* c, const __m128i* m)
+{
+    Repeat<16>::Run([b](int i) { b[i] = Rotl<17>(b[i]); });
+    Repeat<48>::Run([a, b, c, m](int j) {
+        const int i = j & 15;
+        // a = ((a ^ (rotl(a', 15) * 5) ^ c) * 3) ^ b13 ^ (b9 & ~b6) ^ m
+        __m128i u = Rotl<15>(a[(j + 11) % 12]);
+        u = Add(_mm_slli_epi32(u, 2), u);
+        u = Xor(Xor(a[j % 12], u), c[(24 - i) & 15]);
+        u = Add(_mm_slli_epi32(u, 1), u);
+        a[j % 12] = Xor(Xor(u, b[(i + 13) & 15]), Xor(_mm_andnot_si128(b[(i + 6) & 15], b[(i + 9) & 15]), m[i]));
+        // b = ~(rotl(b, 1) ^ a)
+        b[i] = Xor(Xor(Rotl<1>(b[i]), a[j % 12]), K(0xFFFFFFFF));
+    });
+    Repeat<36>::Run([a, c](int k) { a[(47 - k) % 12] = Add(a[(47 - k) % 12], c[(38 - k) & 15]); });
+}
+
+} // namespace shabal
+
+/// CubeHash-512 (CubeHash16/32-512) constants and rounds.
+namespace cubehash {
+
+const uint32_t IV[32] = {
+    0x2AEA2A61, 0x50F494D4, 0x2D538B8B, 0x4167D83E, 0x3FEE2313, 0xC701CF8C, 0xCC39968E, 0x50AC5695,
+    0x4D42C787, 0xA647A8B3, 0x97CF0BEF, 0x825B4537, 0xEEF864D2, 0xF22090C4, 0xD0E5CD33, 0xA23911AE,
+    0xFCD398D9, 0x148FE485, 0x1B017BEF, 0xB6444532, 0x6A536159, 0x2FF5781C, 0x91FA7934, 0x0DBADEA9,
+    0xD65C8A2B, 0xA5A70E75, 0xB1C62456, 0xBC796576, 0x1921C8F7, 0xE7989AF1, 0x7795D246, 0xD43E3B44
+};
+
+/**
+ * One round, on a state whose halves are stored permuted: logical word i of
+ * the first half is x[i ^ L], logical word i of the second half is
+ * x[16 + (i ^ H)]. The swaps of a round only flip these masks, and two rounds
+ * restore them, so no words are moved.
+ */
+template<int L, int H> void inline Round(__m128i* x)
+{
+    Repeat<16>::Run([x](int i) { x[16 + (i ^ H)] = Add(x[16 + (i ^ H)], x[i ^ L]); });
+    Repeat<16>::Run([x](int i) { x[i] = Rotl<7>(x[i]); });
+    Repeat<16>::Run([x](int i) { x[i ^ L ^ 8] = Xor(x[i ^ L ^ 8], x[16 + (i ^ H)]); });
+    Repeat<16>::Run([x](int i) { x[16 + (i ^ H ^ 2)] = Add(x[16 + (i ^ H ^ 2)], x[i ^ L ^ 8]); });
+    Repeat<16>::Run([x](int i) { x[i] = Rotl<11>(x[i]); });
+    Repeat<16>::Run([x](int i) { x[i ^ L ^ 12] = Xor(x[i ^ L ^ 12], x[16 + (i ^ H ^ 2)]); });
+}
+
+void Rounds(__m128i* x, int rounds)
+{
+    for (int r = 0; r < rounds; r += 2) {
+        Round<0, 0>(x);
+        Round<12, 3>(x);
+    }
+}
+
+} // namespace cubehash
+
+/// Hamsi-512 constants and permutation.
+namespace hamsi {
+
+const uint32_t IV[16] = {
+    0x73746565, 0x6c706172, 0x6b204172, 0x656e6265, 0x72672031, 0x302c2062, 0x75732032, 0x3434362c,
+    0x20422d33, 0x30303120, 0x4c657576, 0x656e2d48, 0x65766572, 0x6c65652c, 0x2042656c, 0x6769756d
+};
+
+const uint32_t ALPHA_N[32] = {
+    0xff00f0f0, 0xccccaaaa, 0xf0f0cccc, 0xff00aaaa, 0xccccaaaa, 0xf0f0ff00, 0xaaaacccc, 0xf0f0ff00,
+    0xf0f0cccc, 0xaaaaff00, 0xccccff00, 0xaaaaf0f0, 0xaaaaf0f0, 0xff00cccc, 0xccccf0f0, 0xff00aaaa,
+    0xccccaaaa, 0xff00f0f0, 0xff00aaaa, 0xf0f0cccc, 0xf0f0ff00, 0xccccaaaa, 0xf0f0ff00, 0xaaaacccc,
+    0xaaaaff00, 0xf0f0cccc, 0xaaaaf0f0, 0xccccff00, 0xff00cccc, 0xaaaaf0f0, 0xff00aaaa, 0xccccf0f0
+};
+
+const uint32_t ALPHA_F[32] = {
+    0xcaf9639c, 0x0ff0f9c0, 0x639c0ff0, 0xcaf9f9c0, 0x0ff0f9c0, 0x639ccaf9, 0xf9c00ff0, 0x639ccaf9,
+    0x639c0ff0, 0xf9c0caf9, 0x0ff0caf9, 0xf9c0639c, 0xf9c0639c, 0xcaf90ff0, 0x0ff0639c, 0xcaf9f9c0,
+    0x0ff0f9c0, 0xcaf9639c, 0xcaf9f9c0, 0x639c0ff0, 0x639ccaf9, 0x0ff0f9c0, 0x639ccaf9, 0xf9c00ff0,
+    0xf9c0caf9, 0x639c0ff0, 0xf9c0639c, 0x0ff0caf9, 0xcaf90ff0, 0xf9c0639c, 0xcaf9f9c0, 0x0ff0639c
+};
+
+/** Where each state word comes from: expanded message word n, or chaining word n - 16. */
+const int STATE_SOURCE[32] = {
+     0,  1, 16, 17,  2,  3, 18, 19, 20, 21,  4,  5, 22, 23,  6,  7,
+     8,  9, 24, 25, 10, 11, 26, 27, 28, 29, 12, 13, 30, 31, 14, 15
+};
+
+/** The twelve word quadruples the linear transformation is applied to, in order. */
+const int L_INDEX[12][4] = {
+    { 0x00, 0x09, 0x12, 0x1B }, { 0x01, 0x0A, 0x13, 0x1C }, { 0x02, 0x0B, 0x14, 0x1D }, { 0x03, 0x0C, 0x15, 0x1E },
+    { 0x04, 0x0D, 0x16, 0x1F }, { 0x05, 0x0E, 0x17, 0x18 }, { 0x06, 0x0F, 0x10, 0x19 }, { 0x07, 0x08, 0x11, 0x1A },
+    { 0x00, 0x02, 0x05, 0x07 }, { 0x10, 0x13, 0x15, 0x16 }, { 0x09, 0x0B, 0x0C, 0x0E }, { 0x19, 0x1A, 0x1C, 0x1F }
+};
+
+void inline Sbox(__m128i& a, __m128i& b, __m128i& c, __m128i& d)
+{
+    __m128i t = a;
+    a = Xor(And(a, c), d);
+    c = Xor(Xor(c, b), a);
+    d = Xor(Or(d, t), b);
+    t = Xor(t, c);
+    b = d;
+    d = Xor(Or(d, t), a);
+    a = And(a, b);
+    t = Xor(t, a);
+    b = Xor(Xor(b, d), t);
+    a = c;
+    c = b;
+    b = d;
+    d = Xor(t, K(0xFFFFFFFF));
+}
+
+void inline L(__m128i& a, __m128i& b, __m128i& c, __m128i& d)
+{
+    a = Rotl<13>(a);
+    c = Rotl<3>(c);
+    b = Xor(b, Xor(a, c));
+    d = Xor(d, Xor(c, _mm_slli_epi32(a, 3)));
+    b = Rotl<1>(b);
+    d = Rotl<7>(d);
+    a = Xor(a, Xor(b, d));
+    c = Xor(c, Xor(d, _mm_slli_epi32(b, 7)));
+    a = Rotl<5>(a);
+    c = Rotl<22>(c);
+}
+
+/** Inject one expanded message block into the chaining value h. */
+void Block(__m128i* h, const __m128i* m, const uint32_t* alpha, int rounds)
+{
+    __m128i s[32];
+    Repeat<32>::Run([h, m, &s](int i) { s[i] = STATE_SOURCE[i] < 16 ? m[STATE_SOURCE[i]] : h[STATE_SOURCE[i] - 16]; });
+    for (int r = 0; r < rounds; r++) {
+        Repeat<32>::Run([alpha, &s](int i) { s[i] = Xor(s[i], K(alpha[i])); });
+        s[1] = Xor(s[1], K(r));
+        Repeat<8>::Run([&s](int i) { Sbox(s[i], s[i + 8], s[i + 16], s[i + 24]); });
+        Repeat<12>::Run([&s](int i) { L(s[L_INDEX[i][0]], s[L_INDEX[i][1]], s[L_INDEX[i][2]], s[L_INDEX[i][3]]); });
+    }
+    for (int i = 0; i < 8; i++) {
+        h[i] = Xor(h[i], s[i]);
+        h[i + 8] = Xor(h[i + 8], s[i + 16]);
+    }
+}
+
+/** Expand the same 8-byte block of four messages, each 64 bytes apart. */
+void inline Expand4(__m128i* m, const unsigned char* in)
+{
+    alignas(16) uint32_t w[4][16];
+    for (int lane = 0; lane < 4; lane++) {
+        sph_hamsi_big_expand(in + 64 * lane, w[lane]);
+    }
+    for (int i = 0; i < 16; i += 4) {
+        m[i] = _mm_load_si128((const __m128i*)&w[0][i]);
+        m[i + 1] = _mm_load_si128((const __m128i*)&w[1][i]);
+        m[i + 2] = _mm_load_si128((const __m128i*)&w[2][i]);
+        m[i + 3] = _mm_load_si128((const __m128i*)&w[3][i]);
+        Transpose(m[i], m[i + 1], m[i + 2], m[i + 3]);
+    }
+}
+
+} // namespace hamsi
+
+} // namespace
+
+void Shabal512_64_4way(unsigned char* out, const unsigned char* in)
+{
+    __m128i a[12], b[16], c[16], m[16];
+    for (int i = 0; i < 12; i++) a[i] = K(shabal::A_INIT[i]);
+    for (int i = 0; i < 16; i++) b[i] = K(shabal::B_INIT[i]);
+    for (int i = 0; i < 16; i++) c[i] = K(shabal::C_INIT[i]);
+
+    // The message is exactly one block, with counter W = 1.
+    for (int i = 0; i < 16; i++) {
+        m[i] = Read4(in, i);
+        b[i] = Add(b[i], m[i]);
+    }
+    a[0] = Xor(a[0], K(1));
+    shabal::Permute(a, b, c, m);
+    for (int i = 0; i < 16; i++) {
+        c[i] = Sub(c[i], m[i]);
+        Swap(b[i], c[i]);
+    }
+
+    // The padding block, with counter W = 2, followed by three final
+    // rounds that reuse it.
+    m[0] = K(0x80);
+    for (int i = 1; i < 16; i++) m[i] = _mm_setzero_si128();
+    b[0] = Add(b[0], m[0]);
+    a[0] = Xor(a[0], K(2));
+    shabal::Permute(a, b, c, m);
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 16; i++) Swap(b[i], c[i]);
+        a[0] = Xor(a[0], K(2));
+        shabal::Permute(a, b, c, m);
+    }
+
+    for (int i = 0; i < 16; i++) {
+        Write4(out, i, b[i]);
+    }
+}
+
+void CubeHash512_64_4way(unsigned char* out, const unsigned char* in)
+{
+    __m128i x[32];
+    for (int i = 0; i < 32; i++) x[i] = K(cubehash::IV[i]);
+
+    // Two 32-byte message blocks, then the padding block.
+    for (int block = 0; block < 2; block++) {
+        for (int i = 0; i < 8; i++) {
+            x[i] = Xor(x[i], Read4(in, 8 * block + i));
+        }
+        cubehash::Rounds(x, 16);
+    }
+    x[0] = Xor(x[0], K(0x80));
+    cubehash::Rounds(x, 16);
+
+    // Finalization.
+    x[31] = Xor(x[31], K(1));
+    cubehash::Rounds(x, 160);
+
+    for (int i = 0; i < 16; i++) {
+        Write4(out, i, x[i]);
+    }
+}
+
+void Hamsi512_64_4way(unsigned char* out, const unsigned char* in)
+{
+    __m128i h[16], m[16];
+    for (int i = 0; i < 16; i++) h[i] = K(hamsi::IV[i]);
+
+    for (int block = 0; block < 8; block++) {
+        hamsi::Expand4(m, in + 8 * block);
+        hamsi::Block(h, m, hamsi::ALPHA_N, 6);
+    }
+
+    // The padding block and the final block holding the bit length are
+    // the same for all lanes.
+    static const unsigned char padding[8] = {0x80, 0, 0, 0, 0, 0, 0, 0};
+    static const unsigned char length[8] = {0, 0, 0, 0, 0, 0, 0x02, 0};
+    uint32_t w[16];
+    sph_hamsi_big_expand(padding, w);
+    for (int i = 0; i < 16; i++) m[i] = K(w[i]);
+    hamsi::Block(h, m, hamsi::ALPHA_N, 6);
+    sph_hamsi_big_expand(length, w);
+    for (int i = 0; i < 16; i++) m[i] = K(w[i]);
+    hamsi::Block(h, m, hamsi::ALPHA_F, 12);
+
+    alignas(16) uint32_t res[4];
+    for (int i = 0; i < 16; i++) {
+        _mm_store_si128((__m128i*)res, h[i]);
+        for (int lane = 0; lane < 4; lane++) {
+            WriteBE32(out + 64 * lane + 4 * i, res[lane]);
+        }
+    }
+}
+
+} // namespace hashgeek_sse2
+
+#endif
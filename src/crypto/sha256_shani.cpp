@@ -0,0 +1,97 @@
+// Copyright (c) 2018 The GeekCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This is a SHA-256 transform built on the x86 SHA extensions (SHA-NI).
+// Each SHA256RNDS2 performs two rounds, and SHA256MSG1/SHA256MSG2 compute
+// the message schedule four words at a time. The state is kept in the
+// ABEF/CDGH register layout these instructions expect.
+
+#ifdef ENABLE_SHANI
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace sha256_shani {
+namespace {
+
+const __m128i ROUND_K[16] = {
+    _mm_set_epi64x(0xe9b5dba5b5c0fbcfULL, 0x71374491428a2f98ULL),
+    _mm_set_epi64x(0xab1c5ed5923f82a4ULL, 0x59f111f13956c25bULL),
+    _mm_set_epi64x(0x550c7dc3243185beULL, 0x12835b01d807aa98ULL),
+    _mm_set_epi64x(0xc19bf1749bdc06a7ULL, 0x80deb1fe72be5d74ULL),
+    _mm_set_epi64x(0x240ca1cc0fc19dc6ULL, 0xefbe4786e49b69c1ULL),
+    _mm_set_epi64x(0x76f988da5cb0a9dcULL, 0x4a7484aa2de92c6fULL),
+    _mm_set_epi64x(0xbf597fc7b00327c8ULL, 0xa831c66d983e5152ULL),
+    _mm_set_epi64x(0x1429296706ca6351ULL, 0xd5a79147c6e00bf3ULL),
+    _mm_set_epi64x(0x53380d134d2c6dfcULL, 0x2e1b213827b70a85ULL),
+    _mm_set_epi64x(0x92722c8581c2c92eULL, 0x766a0abb650a7354ULL),
+    _mm_set_epi64x(0xc76c51a3c24b8b70ULL, 0xa81a664ba2bfe8a1ULL),
+    _mm_set_epi64x(0x106aa070f40e3585ULL, 0xd6990624d192e819ULL),
+    _mm_set_epi64x(0x34b0bcb52748774cULL, 0x1e376c0819a4c116ULL),
+    _mm_set_epi64x(0x682e6ff35b9cca4fULL, 0x4ed8aa4a391c0cb3ULL),
+    _mm_set_epi64x(0x8cc7020884c87814ULL, 0x78a5636f748f82eeULL),
+    _mm_set_epi64x(0xc67178f2bef9a3f7ULL, 0xa4506ceb90befffaULL)
+};
+
+/** Calls f(0), ..., f(N - 1), with every index a compile-time constant after inlining. */
+template<int N>
+struct Repeat {
+    template<typename F> static void inline Run(F f) { Repeat<N - 1>::Run(f); f(N - 1); }
+};
+template<>
+struct Repeat<0> {
+    template<typename F> static void inline Run(F) {}
+};
+
+} // namespace
+
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // Reorder the state from ABCD/EFGH into ABEF/CDGH.
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)s), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(s + 4)), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    while (blocks--) {
+        const __m128i save0 = state0, save1 = state1;
+        __m128i m[4];
+
+        // Sixteen groups of four rounds. Group j consumes message words
+        // 4j..4j+3 from m[j % 4] and finishes computing the words of
+        // group j + 1.
+        Repeat<16>::Run([&](int j) {
+            if (j < 4) {
+                m[j] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + 16 * j)), mask);
+            }
+            __m128i msg = _mm_add_epi32(m[j & 3], ROUND_K[j]);
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            if (j >= 3 && j <= 14) {
+                m[(j + 1) & 3] = _mm_add_epi32(m[(j + 1) & 3], _mm_alignr_epi8(m[j & 3], m[(j - 1) & 3], 4));
+                m[(j + 1) & 3] = _mm_sha256msg2_epu32(m[(j + 1) & 3], m[j & 3]);
+            }
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+            if (j >= 1 && j <= 12) {
+                m[(j - 1) & 3] = _mm_sha256msg1_epu32(m[(j - 1) & 3], m[j & 3]);
+            }
+        });
+
+        state0 = _mm_add_epi32(state0, save0);
+        state1 = _mm_add_epi32(state1, save1);
+        chunk += 64;
+    }
+
+    // Reorder the state back into ABCD/EFGH.
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    _mm_storeu_si128((__m128i*)s, _mm_blend_epi16(tmp, state1, 0xF0));
+    _mm_storeu_si128((__m128i*)(s + 4), _mm_alignr_epi8(state1, tmp, 8));
+}
+
+} // namespace sha256_shani
+
+#endif
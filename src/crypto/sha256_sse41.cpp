@@ -0,0 +1,163 @@
+// Copyright (c) 2018 The GeekCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This is a 4-way SIMD implementation of double-SHA256 on 64-byte inputs,
+// each lane holding one 32-bit word of an independent message. The byte
+// swaps and the transposition of the inputs and outputs use SSSE3 shuffles,
+// which every SSE4.1 CPU has.
+
+#ifdef ENABLE_SSE41
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace sha256d64_sse41 {
+namespace {
+
+__m128i inline K(uint32_t x) { return _mm_set1_epi32(x); }
+
+__m128i inline Add(__m128i x, __m128i y) { return _mm_add_epi32(x, y); }
+__m128i inline Add(__m128i x, __m128i y, __m128i z) { return Add(Add(x, y), z); }
+__m128i inline Add(__m128i x, __m128i y, __m128i z, __m128i w) { return Add(Add(x, y), Add(z, w)); }
+__m128i inline Xor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+__m128i inline Xor(__m128i x, __m128i y, __m128i z) { return Xor(Xor(x, y), z); }
+__m128i inline Or(__m128i x, __m128i y) { return _mm_or_si128(x, y); }
+__m128i inline And(__m128i x, __m128i y) { return _mm_and_si128(x, y); }
+template<int n> __m128i inline ShR(__m128i x) { return _mm_srli_epi32(x, n); }
+template<int n> __m128i inline Ror(__m128i x) { return Or(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - n)); }
+
+__m128i inline Ch(__m128i x, __m128i y, __m128i z) { return Xor(z, And(x, Xor(y, z))); }
+__m128i inline Maj(__m128i x, __m128i y, __m128i z) { return Or(And(x, y), And(z, Or(x, y))); }
+__m128i inline Sigma0(__m128i x) { return Xor(Ror<2>(x), Ror<13>(x), Ror<22>(x)); }
+__m128i inline Sigma1(__m128i x) { return Xor(Ror<6>(x), Ror<11>(x), Ror<25>(x)); }
+__m128i inline sigma0(__m128i x) { return Xor(Ror<7>(x), Ror<18>(x), ShR<3>(x)); }
+__m128i inline sigma1(__m128i x) { return Xor(Ror<17>(x), Ror<19>(x), ShR<10>(x)); }
+
+/** One round of SHA-256, with k the sum of the round constant and the message word. */
+void inline Round(__m128i a, __m128i b, __m128i c, __m128i& d, __m128i e, __m128i f, __m128i g, __m128i& h, __m128i k)
+{
+    __m128i t1 = Add(h, Sigma1(e), Ch(e, f, g), k);
+    __m128i t2 = Add(Sigma0(a), Maj(a, b, c));
+    d = Add(d, t1);
+    h = Add(t1, t2);
+}
+
+/** Calls f(0), ..., f(N - 1), with every index a compile-time constant after inlining. */
+template<int N>
+struct Repeat {
+    template<typename F> static void inline Run(F f) { Repeat<N - 1>::Run(f); f(N - 1); }
+};
+template<>
+struct Repeat<0> {
+    template<typename F> static void inline Run(F) {}
+};
+
+const uint32_t IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+const uint32_t ROUND_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/** Round constants plus the expanded padding block of a 64-byte message. */
+const uint32_t PADDING_KW[64] = {
+    0xc28a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf374,
+    0x649b69c1, 0xf0fe4786, 0x0fe1edc6, 0x240cf254, 0x4fe9346f, 0x6cc984be, 0x61b9411e, 0x16f988fa,
+    0xf2c65152, 0xa88e5a6d, 0xb019fc65, 0xb9d99ec7, 0x9a1231c3, 0xe70eeaa0, 0xfdb1232b, 0xc7353eb0,
+    0x3069bad5, 0xcb976d5f, 0x5a0f118f, 0xdc1eeefd, 0x0a35b689, 0xde0b7a04, 0x58f4ca9d, 0xe15d5b16,
+    0x007f3e86, 0x37088980, 0xa507ea32, 0x6fab9537, 0x17406110, 0x0d8cd6f1, 0xcdaa3b6d, 0xc0bbbe37,
+    0x83613bda, 0xdb48a363, 0x0b02e931, 0x6fd15ca7, 0x521afaca, 0x31338431, 0x6ed41a95, 0x6d437890,
+    0xc39c91f2, 0x9eccabbd, 0xb5c9a0e6, 0x532fb63c, 0xd2c741c6, 0x07237ea3, 0xa4954b68, 0x4c191d76
+};
+
+/** Run the 64 rounds on v, expanding the message schedule in w in place. */
+void inline Compress(__m128i* v, __m128i* w)
+{
+    Repeat<64>::Run([v, w](int i) {
+        if (i >= 16) {
+            w[i & 15] = Add(w[i & 15], sigma1(w[(i - 2) & 15]), w[(i - 7) & 15], sigma0(w[(i - 15) & 15]));
+        }
+        Round(v[(64 - i) & 7], v[(65 - i) & 7], v[(66 - i) & 7], v[(67 - i) & 7],
+              v[(68 - i) & 7], v[(69 - i) & 7], v[(70 - i) & 7], v[(71 - i) & 7], Add(K(ROUND_K[i]), w[i & 15]));
+    });
+}
+
+/** Run the 64 rounds on v for a message that is the same in every lane. */
+void inline CompressConst(__m128i* v, const uint32_t* kw)
+{
+    Repeat<64>::Run([v, kw](int i) {
+        Round(v[(64 - i) & 7], v[(65 - i) & 7], v[(66 - i) & 7], v[(67 - i) & 7],
+              v[(68 - i) & 7], v[(69 - i) & 7], v[(70 - i) & 7], v[(71 - i) & 7], K(kw[i]));
+    });
+}
+
+/** Transpose a 4x4 matrix of 32-bit words held in four registers. */
+void inline Transpose(__m128i& r0, __m128i& r1, __m128i& r2, __m128i& r3)
+{
+    const __m128i t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpacklo_epi32(r2, r3);
+    const __m128i t2 = _mm_unpackhi_epi32(r0, r1), t3 = _mm_unpackhi_epi32(r2, r3);
+    r0 = _mm_unpacklo_epi64(t0, t1);
+    r1 = _mm_unpackhi_epi64(t0, t1);
+    r2 = _mm_unpacklo_epi64(t2, t3);
+    r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+__m128i inline ByteSwap(__m128i x)
+{
+    return _mm_shuffle_epi8(x, _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3));
+}
+
+} // namespace
+
+void Transform_4way(unsigned char* out, const unsigned char* in)
+{
+    __m128i s[8], v[8], w[16];
+
+    // Transform 1: the 64-byte messages, read as big-endian words.
+    for (int i = 0; i < 16; i += 4) {
+        for (int lane = 0; lane < 4; lane++) {
+            w[i + lane] = _mm_loadu_si128((const __m128i*)(in + 64 * lane + 4 * i));
+        }
+        Transpose(w[i], w[i + 1], w[i + 2], w[i + 3]);
+        for (int j = 0; j < 4; j++) {
+            w[i + j] = ByteSwap(w[i + j]);
+        }
+    }
+    for (int i = 0; i < 8; i++) s[i] = v[i] = K(IV[i]);
+    Compress(v, w);
+    for (int i = 0; i < 8; i++) s[i] = v[i] = Add(s[i], v[i]);
+
+    // Transform 2: the padding block, which is the same for every lane.
+    CompressConst(v, PADDING_KW);
+    for (int i = 0; i < 8; i++) w[i] = Add(s[i], v[i]);
+
+    // Transform 3: the 32-byte hash of the first pass, padded.
+    w[8] = K(0x80000000);
+    for (int i = 9; i < 15; i++) w[i] = K(0);
+    w[15] = K(256);
+    for (int i = 0; i < 8; i++) v[i] = K(IV[i]);
+    Compress(v, w);
+    for (int i = 0; i < 8; i++) v[i] = ByteSwap(Add(v[i], K(IV[i])));
+
+    // Transpose back to one 32-byte digest per lane.
+    Transpose(v[0], v[1], v[2], v[3]);
+    Transpose(v[4], v[5], v[6], v[7]);
+    for (int lane = 0; lane < 4; lane++) {
+        _mm_storeu_si128((__m128i*)(out + 32 * lane), v[lane]);
+        _mm_storeu_si128((__m128i*)(out + 32 * lane + 16), v[lane + 4]);
+    }
+}
+
+} // namespace sha256d64_sse41
+
+#endif
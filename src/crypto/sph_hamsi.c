@@ -862,6 +862,33 @@ sph_hamsi512_addbits_and_close(void *cc, unsigned ub, unsigned n, void *dst)
     hamsi_big_init(cc, IV512);
 }
 
+/* see sph_hamsi.h */
+void
+sph_hamsi_big_expand(const void *data, sph_u32 *m)
+{
+    const unsigned char *buf = data;
+    sph_u32 m0, m1, m2, m3, m4, m5, m6, m7;
+    sph_u32 m8, m9, mA, mB, mC, mD, mE, mF;
+
+    INPUT_BIG;
+    m[0x0] = m0;
+    m[0x1] = m1;
+    m[0x2] = m2;
+    m[0x3] = m3;
+    m[0x4] = m4;
+    m[0x5] = m5;
+    m[0x6] = m6;
+    m[0x7] = m7;
+    m[0x8] = m8;
+    m[0x9] = m9;
+    m[0xA] = mA;
+    m[0xB] = mB;
+    m[0xC] = mC;
+    m[0xD] = mD;
+    m[0xE] = mE;
+    m[0xF] = mF;
+}
+
 #ifdef __cplusplus
 }
 #endif
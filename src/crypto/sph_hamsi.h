@@ -312,6 +312,16 @@ void sph_hamsi512_close(void *cc, void *dst);
 void sph_hamsi512_addbits_and_close(
     void *cc, unsigned ub, unsigned n, void *dst);
 
+/**
+ * Expand one 8-byte message block into the sixteen 32-bit words that
+ * Hamsi-384 and Hamsi-512 inject into their state. This allows another
+ * implementation of the permutation to share the expansion tables.
+ *
+ * @param data   the message block (8 bytes)
+ * @param m      the expanded words (16 words)
+ */
+void sph_hamsi_big_expand(const void *data, sph_u32 *m);
+
 
 
 #ifdef __cplusplus
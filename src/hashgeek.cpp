@@ -0,0 +1,270 @@
+// Copyright (c) 2018 The GeekCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/geekcash-config.h"
+#endif
+
+#include "hashgeek.h"
+
+#include <string.h>
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
+#if defined(__SSE2__)
+namespace hashgeek_sse2
+{
+void Shabal512_64_4way(unsigned char* out, const unsigned char* in);
+void CubeHash512_64_4way(unsigned char* out, const unsigned char* in);
+void Hamsi512_64_4way(unsigned char* out, const unsigned char* in);
+}
+#endif
+
+#if defined(ENABLE_AESNI)
+namespace hashgeek_aesni
+{
+void Echo512_64_4way(unsigned char* out, const unsigned char* in);
+}
+#endif
+
+#if defined(ENABLE_AVX2)
+namespace hashgeek_avx2
+{
+void Blake512_4way(unsigned char* out, const unsigned char* in, size_t len);
+void Bmw512_64_4way(unsigned char* out, const unsigned char* in);
+void Keccak512_64_4way(unsigned char* out, const unsigned char* in);
+}
+#endif
+
+namespace
+{
+/** The state of every stage right after its sph init function, computed once. */
+struct InitialContexts
+{
+    sph_blake512_context      blake;
+    sph_bmw512_context        bmw;
+    sph_groestl512_context    groestl;
+    sph_keccak512_context     keccak;
+    sph_cubehash512_context   cubehash;
+    sph_echo512_context       echo;
+    sph_hamsi512_context      hamsi;
+    sph_shabal512_context     shabal;
+    sph_simd512_context       simd;
+
+    InitialContexts()
+    {
+        sph_blake512_init(&blake);
+        sph_bmw512_init(&bmw);
+        sph_groestl512_init(&groestl);
+        sph_keccak512_init(&keccak);
+        sph_cubehash512_init(&cubehash);
+        sph_echo512_init(&echo);
+        sph_hamsi512_init(&hamsi);
+        sph_shabal512_init(&shabal);
+        sph_simd512_init(&simd);
+    }
+};
+
+/** The initial contexts. A function-local static, because block headers (the
+ *  genesis blocks) are already hashed during static initialization. */
+const InitialContexts& Initial()
+{
+    static const InitialContexts contexts;
+    return contexts;
+}
+
+/** Longest input the single-block BLAKE-512 kernels can handle. */
+const size_t MAX_BLAKE_SINGLE_BLOCK = 111;
+
+typedef void (*Blake512Way4Type)(unsigned char*, const unsigned char*, size_t);
+/** Hash four contiguous 64-byte inputs into four contiguous 64-byte digests. */
+typedef void (*Stage512Way4Type)(unsigned char*, const unsigned char*);
+
+/** Fallback for a chained stage without a 4-way kernel: hash each lane with sph. */
+template<typename Context, Context InitialContexts::*Init, void (*Update)(void*, const void*, size_t), void (*Close)(void*, void*)>
+void Stage512_64_1way(unsigned char* out, const unsigned char* in)
+{
+    const Context& init = Initial().*Init;
+    Context ctx;
+    for (int lane = 0; lane < 4; lane++) {
+        ctx = init;
+        Update(&ctx, in + 64 * lane, 64);
+        Close(&ctx, out + 64 * lane);
+    }
+}
+
+Blake512Way4Type Blake512_4way = NULL;
+Stage512Way4Type Bmw512_4way = Stage512_64_1way<sph_bmw512_context, &InitialContexts::bmw, sph_bmw512, sph_bmw512_close>;
+Stage512Way4Type Echo512_4way = Stage512_64_1way<sph_echo512_context, &InitialContexts::echo, sph_echo512, sph_echo512_close>;
+Stage512Way4Type Shabal512_4way = Stage512_64_1way<sph_shabal512_context, &InitialContexts::shabal, sph_shabal512, sph_shabal512_close>;
+Stage512Way4Type Groestl512_4way = Stage512_64_1way<sph_groestl512_context, &InitialContexts::groestl, sph_groestl512, sph_groestl512_close>;
+Stage512Way4Type CubeHash512_4way = Stage512_64_1way<sph_cubehash512_context, &InitialContexts::cubehash, sph_cubehash512, sph_cubehash512_close>;
+Stage512Way4Type Keccak512_4way = Stage512_64_1way<sph_keccak512_context, &InitialContexts::keccak, sph_keccak512, sph_keccak512_close>;
+Stage512Way4Type Hamsi512_4way = Stage512_64_1way<sph_hamsi512_context, &InitialContexts::hamsi, sph_hamsi512, sph_hamsi512_close>;
+Stage512Way4Type Simd512_4way = Stage512_64_1way<sph_simd512_context, &InitialContexts::simd, sph_simd512, sph_simd512_close>;
+
+/** Whether at least one stage has a vectorized kernel, so batching pays off. */
+bool fBatchKernels = false;
+
+/** Hash four inputs, using the 4-way kernels for the stages that have one. */
+void HashGeek4Way(const unsigned char* in, size_t len, uint256* out)
+{
+    unsigned char buf1[4 * 64];
+    unsigned char buf2[4 * 64];
+
+    if (Blake512_4way && len <= MAX_BLAKE_SINGLE_BLOCK) {
+        Blake512_4way(buf1, in, len);
+    } else {
+        sph_blake512_context ctx_blake;
+        for (int lane = 0; lane < 4; lane++) {
+            ctx_blake = Initial().blake;
+            sph_blake512 (&ctx_blake, in + len * lane, len);
+            sph_blake512_close(&ctx_blake, buf1 + 64 * lane);
+        }
+    }
+
+    Bmw512_4way(buf2, buf1);
+    Echo512_4way(buf1, buf2);
+    Shabal512_4way(buf2, buf1);
+    Groestl512_4way(buf1, buf2);
+    CubeHash512_4way(buf2, buf1);
+    Keccak512_4way(buf1, buf2);
+    Hamsi512_4way(buf2, buf1);
+    Simd512_4way(buf1, buf2);
+
+    for (int lane = 0; lane < 4; lane++) {
+        uint512 result;
+        memcpy(result.begin(), buf1 + 64 * lane, 64);
+        out[lane] = result.trim256();
+    }
+}
+
+#if defined(USE_ASM) && defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+/** Check whether the OS has enabled AVX registers. */
+bool AVXEnabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+#endif
+} // namespace
+
+uint256 CHashGeek::Hash(const unsigned char* data, size_t len)
+{
+    const InitialContexts& init = Initial();
+    // The chain alternates between two buffers rather than keeping every
+    // intermediate hash.
+    uint512 hash[2];
+
+    ctx_blake = init.blake;
+    sph_blake512 (&ctx_blake, data, len);
+    sph_blake512_close(&ctx_blake, hash[0].begin());
+
+    ctx_bmw = init.bmw;
+    sph_bmw512 (&ctx_bmw, hash[0].begin(), 64);
+    sph_bmw512_close(&ctx_bmw, hash[1].begin());
+
+    ctx_echo = init.echo;
+    sph_echo512 (&ctx_echo, hash[1].begin(), 64);
+    sph_echo512_close(&ctx_echo, hash[0].begin());
+
+    ctx_shabal = init.shabal;
+    sph_shabal512 (&ctx_shabal, hash[0].begin(), 64);
+    sph_shabal512_close(&ctx_shabal, hash[1].begin());
+
+    ctx_groestl = init.groestl;
+    sph_groestl512 (&ctx_groestl, hash[1].begin(), 64);
+    sph_groestl512_close(&ctx_groestl, hash[0].begin());
+
+    ctx_cubehash = init.cubehash;
+    sph_cubehash512 (&ctx_cubehash, hash[0].begin(), 64);
+    sph_cubehash512_close(&ctx_cubehash, hash[1].begin());
+
+    ctx_keccak = init.keccak;
+    sph_keccak512 (&ctx_keccak, hash[1].begin(), 64);
+    sph_keccak512_close(&ctx_keccak, hash[0].begin());
+
+    ctx_hamsi = init.hamsi;
+    sph_hamsi512 (&ctx_hamsi, hash[0].begin(), 64);
+    sph_hamsi512_close(&ctx_hamsi, hash[1].begin());
+
+    ctx_simd = init.simd;
+    sph_simd512 (&ctx_simd, hash[1].begin(), 64);
+    sph_simd512_close(&ctx_simd, hash[0].begin());
+
+    return hash[0].trim256();
+}
+
+uint256 HashGeekBytes(const unsigned char* data, size_t len)
+{
+#ifdef HAVE_THREAD_LOCAL
+    static thread_local CHashGeek hasher;
+#else
+    CHashGeek hasher;
+#endif
+    return hasher.Hash(data, len);
+}
+
+std::string HashGeekAutoDetect()
+{
+    std::string ret;
+
+#if defined(__SSE2__)
+    // SSE2 is part of the x86-64 baseline; if the compiler targets it, so can we.
+    Shabal512_4way = hashgeek_sse2::Shabal512_64_4way;
+    CubeHash512_4way = hashgeek_sse2::CubeHash512_64_4way;
+    Hamsi512_4way = hashgeek_sse2::Hamsi512_64_4way;
+    fBatchKernels = true;
+    ret = "sse2(4way)";
+#endif
+
+#if defined(USE_ASM) && (defined(ENABLE_AESNI) || defined(ENABLE_AVX2)) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+    uint32_t eax, ebx, ecx, edx;
+#if defined(ENABLE_AESNI)
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && ((ecx >> 25) & 1)) {
+        Echo512_4way = hashgeek_aesni::Echo512_64_4way;
+        fBatchKernels = true;
+        ret += ret.empty() ? "aesni(1way)" : ",aesni(1way)";
+    }
+#endif
+#if defined(ENABLE_AVX2)
+    // AVX2 needs the XSAVE and AVX feature flags, OS support for the YMM
+    // registers, and the AVX2 flag in the extended feature leaf.
+    if (__get_cpuid_max(0, NULL) >= 7 && __get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+        ((ecx >> 27) & 1) && ((ecx >> 28) & 1) && AVXEnabled()) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if ((ebx >> 5) & 1) {
+            Blake512_4way = hashgeek_avx2::Blake512_4way;
+            Bmw512_4way = hashgeek_avx2::Bmw512_64_4way;
+            Keccak512_4way = hashgeek_avx2::Keccak512_64_4way;
+            fBatchKernels = true;
+            ret += ret.empty() ? "avx2(4way)" : ",avx2(4way)";
+        }
+    }
+#endif
+#endif
+
+    return ret.empty() ? "standard" : ret;
+}
+
+void HashGeekBatch(const unsigned char* in, size_t len, size_t count, uint256* out)
+{
+    if (fBatchKernels) {
+        while (count >= 4) {
+            HashGeek4Way(in, len, out);
+            in += 4 * len;
+            out += 4;
+            count -= 4;
+        }
+    }
+    while (count > 0) {
+        *out = HashGeek(in, in + len);
+        in += len;
+        out += 1;
+        count -= 1;
+    }
+}
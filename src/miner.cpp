@@ -15,6 +15,7 @@
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
 #include "hash.h"
+#include "hashgeek.h"
 #include "validation.h"
 #include "net.h"
 #include "policy/policy.h"
@@ -31,6 +32,8 @@
 
 #include <boost/thread.hpp>
 #include <boost/tuple/tuple.hpp>
+#include <atomic>
+#include <memory>
 #include <queue>
 
 using namespace std;
@@ -133,7 +136,7 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& s
         const int64_t nMedianTimePast = pindexPrev->GetMedianTimePast();
 
         // Add our coinbase tx as first transaction
-        pblock->vtx.push_back(txNew);
+        pblock->vtx.push_back(CTransactionRef());
         pblocktemplate->vTxFees.push_back(-1); // updated at end
         pblocktemplate->vTxSigOps.push_back(-1); // updated at end
         pblock->nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
@@ -242,7 +245,7 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& s
 
                 CAmount nTxFees = iter->GetFee();
                 // Added
-                pblock->vtx.push_back(tx);
+                pblock->vtx.push_back(iter->GetSharedTx());
                 pblocktemplate->vTxFees.push_back(nTxFees);
                 pblocktemplate->vTxSigOps.push_back(nTxSigOps);
                 nBlockSize += nTxSize;
@@ -301,7 +304,7 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& s
         LogPrintf("CreateNewBlock(): total size %u txs: %u fees: %ld sigops %d\n", nBlockSize, nBlockTx, nFees, nBlockSigOps);
 
         // Update block coinbase
-        pblock->vtx[0] = txNew;
+        pblock->vtx[0] = MakeTransactionRef(std::move(txNew));
         pblocktemplate->vTxFees[0] = -nFees;
 
         // Fill in header
@@ -309,7 +312,8 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& s
         UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev);
         pblock->nBits          = GetNextWorkRequired(pindexPrev, pblock, chainparams.GetConsensus());
         pblock->nNonce         = 0;
-        pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(pblock->vtx[0]);
+        pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(*pblock->vtx[0]);
+        pblock->hashMerkleRoot = BlockMerkleRootAndBranch(*pblock, 0, pblocktemplate->vCoinbaseBranch);
 
         CValidationState state;
         if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false)) {
@@ -320,7 +324,14 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& s
     return pblocktemplate.release();
 }
 
-void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
+static void SetCoinbaseExtraNonce(CMutableTransaction& txCoinbase, const CBlockIndex* pindexPrev, unsigned int nExtraNonce)
+{
+    unsigned int nHeight = pindexPrev->nHeight+1; // Height first in coinbase required for block.version=2
+    txCoinbase.vin[0].scriptSig = (CScript() << nHeight << CScriptNum(nExtraNonce)) + COINBASE_FLAGS;
+    assert(txCoinbase.vin[0].scriptSig.size() <= 100);
+}
+
+static void UpdateCoinbaseExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
 {
     // Update nExtraNonce
     static uint256 hashPrevBlock;
@@ -330,15 +341,26 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
         hashPrevBlock = pblock->hashPrevBlock;
     }
     ++nExtraNonce;
-    unsigned int nHeight = pindexPrev->nHeight+1; // Height first in coinbase required for block.version=2
-    CMutableTransaction txCoinbase(pblock->vtx[0]);
-    txCoinbase.vin[0].scriptSig = (CScript() << nHeight << CScriptNum(nExtraNonce)) + COINBASE_FLAGS;
-    assert(txCoinbase.vin[0].scriptSig.size() <= 100);
+    CMutableTransaction txCoinbase(*pblock->vtx[0]);
+    SetCoinbaseExtraNonce(txCoinbase, pindexPrev, nExtraNonce);
+
+    pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
+}
 
-    pblock->vtx[0] = txCoinbase;
+void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
+{
+    UpdateCoinbaseExtraNonce(pblock, pindexPrev, nExtraNonce);
     pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
 }
 
+void IncrementExtraNonce(CBlockTemplate* pblocktemplate, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
+{
+    CBlock* pblock = &pblocktemplate->block;
+    UpdateCoinbaseExtraNonce(pblock, pindexPrev, nExtraNonce);
+    // Only the coinbase leaf changed, so walk its branch up to the root.
+    pblock->hashMerkleRoot = ComputeMerkleRootFromBranch(pblock->vtx[0]->GetHash(), pblocktemplate->vCoinbaseBranch, 0);
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // Internal miner
@@ -381,7 +403,7 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
 static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainparams)
 {
     LogPrintf("%s\n", pblock->ToString());
-    LogPrintf("generated %s\n", FormatMoney(pblock->vtx[0].vout[0].nValue));
+    LogPrintf("generated %s\n", FormatMoney(pblock->vtx[0]->vout[0].nValue));
 
     // Found a solution
     {
@@ -400,15 +422,63 @@ static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainpar
     return true;
 }
 
-// ***TODO*** that part changed in bitcoin, we are using a mix with old one here for now
-void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman)
+// The internal miner runs one control thread and a number of worker threads.
+// The control thread builds a block template and publishes it to the
+// workers, replacing it when the tip or the mempool changes and refreshing
+// the header time. Every worker hashes the same template. Worker i of N
+// only uses the extranonces i+1, i+1+N, i+1+2N, ..., so no two workers ever
+// build the same coinbase and their nonce searches never overlap. Each one
+// scans the nonce range of an extranonce in batches of MINER_HASH_BATCH,
+// then moves on to its next extranonce, which only costs a walk up the
+// cached coinbase branch.
+
+namespace {
+
+/** A block template shared by the miner threads */
+struct CMinerWork
+{
+    std::shared_ptr<const CBlockTemplate> pblocktemplate;
+    const CBlockIndex* pindexPrev;
+    boost::shared_ptr<CReserveScript> coinbaseScript;
+    /** Header time and difficulty, refreshed without rebuilding the template */
+    uint32_t nTime;
+    uint32_t nBits;
+};
+
+CCriticalSection cs_minerWork;
+/** The current work, or NULL while there is none */
+std::shared_ptr<const CMinerWork> pminerWork;
+/** Incremented whenever pminerWork changes, so workers can poll it without locking */
+std::atomic<uint64_t> nMinerWorkGeneration(0);
+/** Set when the miner threads should exit, e.g. after a block on regtest */
+std::atomic<bool> fMinerStop(false);
+
+/** Serializes the submission of found blocks */
+CCriticalSection cs_minerSubmit;
+
+CCriticalSection cs_minerStats;
+/** Hashes per second of each worker thread, over its last measurement window */
+std::vector<double> vMinerHashesPerSec;
+
+/** How often a worker refreshes its hash rate, in milliseconds */
+const int64_t MINER_STATS_INTERVAL = 2000;
+/** Number of nonces a worker scans between checks for new work */
+const uint32_t MINER_NONCE_CHUNK = 0x100;
+
+void PublishMinerWork(const std::shared_ptr<const CMinerWork>& pwork)
+{
+    LOCK(cs_minerWork);
+    pminerWork = pwork;
+    nMinerWorkGeneration++;
+}
+
+} // namespace
+
+static void MinerControl(const CChainParams& chainparams, CConnman& connman)
 {
     LogPrintf("GeekCashMiner -- started\n");
-    SetThreadPriority(THREAD_PRIORITY_LOWEST);
     RenameThread("geekcash-miner");
 
-    unsigned int nExtraNonce = 0;
-
     boost::shared_ptr<CReserveScript> coinbaseScript;
     GetMainSignals().ScriptForMining(coinbaseScript);
 
@@ -419,7 +489,7 @@ void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman)
         if (!coinbaseScript || coinbaseScript->reserveScript.empty())
             throw std::runtime_error("No coinbase script available (mining requires a wallet)");
 
-        while (true) {
+        while (!fMinerStop) {
             if (chainparams.MiningRequiresPeers()) {
                 // Busy-wait for the network to come online so we don't waste time mining
                 // on an obsolete chain. In regtest mode we expect to fly solo.
@@ -431,7 +501,6 @@ void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman)
                 } while (true);
             }
 
-
             //
             // Create new block
             //
@@ -439,86 +508,198 @@ void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman)
             CBlockIndex* pindexPrev = chainActive.Tip();
             if(!pindexPrev) break;
 
-            std::unique_ptr<CBlockTemplate> pblocktemplate(CreateNewBlock(chainparams, coinbaseScript->reserveScript));
-            if (!pblocktemplate.get())
+            std::shared_ptr<const CBlockTemplate> pblocktemplate(CreateNewBlock(chainparams, coinbaseScript->reserveScript));
+            if (!pblocktemplate)
             {
                 LogPrintf("GeekCashMiner -- Keypool ran out, please call keypoolrefill before restarting the mining thread\n");
-                return;
+                break;
             }
-            CBlock *pblock = &pblocktemplate->block;
-            IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
-
-            LogPrintf("GeekCashMiner -- Running miner with %u transactions in block (%u bytes)\n", pblock->vtx.size(),
-                ::GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION));
+            const CBlock& block = pblocktemplate->block;
+            LogPrintf("GeekCashMiner -- Running miner with %u transactions in block (%u bytes)\n", block.vtx.size(),
+                ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+
+            std::shared_ptr<CMinerWork> pwork = std::make_shared<CMinerWork>();
+            pwork->pblocktemplate = pblocktemplate;
+            pwork->pindexPrev = pindexPrev;
+            pwork->coinbaseScript = coinbaseScript;
+            pwork->nTime = block.nTime;
+            pwork->nBits = block.nBits;
+            PublishMinerWork(pwork);
 
             //
-            // Search
+            // Watch the work while the workers search
             //
             int64_t nStart = GetTime();
-            arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->nBits);
-            while (true)
+            CBlockHeader header = block.GetBlockHeader();
+            while (!fMinerStop)
             {
-                unsigned int nHashesDone = 0;
-
-                uint256 hash;
-                while (true)
-                {
-                    hash = pblock->GetHash();
-                    if (UintToArith256(hash) <= hashTarget)
-                    {
-                        // Found a solution
-                        SetThreadPriority(THREAD_PRIORITY_NORMAL);
-                        LogPrintf("GeekCashMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
-                        ProcessBlockFound(pblock, chainparams);
-                        SetThreadPriority(THREAD_PRIORITY_LOWEST);
-                        coinbaseScript->KeepScript();
-
-                        // In regression test mode, stop mining after a block is found. This
-                        // allows developers to controllably generate a block on demand.
-                        if (chainparams.MineBlocksOnDemand())
-                            throw boost::thread_interrupted();
+                MilliSleep(100);
 
-                        break;
-                    }
-                    pblock->nNonce += 1;
-                    nHashesDone += 1;
-                    if ((pblock->nNonce & 0xFF) == 0)
-                        break;
-                }
-
-                // Check for stop or if block needs to be rebuilt
-                boost::this_thread::interruption_point();
                 // Regtest mode doesn't require peers
                 if (connman.GetNodeCount(CConnman::CONNECTIONS_ALL) == 0 && chainparams.MiningRequiresPeers())
                     break;
-                if (pblock->nNonce >= 0xffff0000)
-                    break;
                 if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 60)
                     break;
                 if (pindexPrev != chainActive.Tip())
                     break;
 
                 // Update nTime every few seconds
-                if (UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev) < 0)
+                if (UpdateTime(&header, chainparams.GetConsensus(), pindexPrev) < 0)
                     break; // Recreate the block if the clock has run backwards,
                            // so that we can use the correct time.
-                if (chainparams.GetConsensus().fPowAllowMinDifficultyBlocks)
-                {
-                    // Changing pblock->nTime can change work required on testnet:
-                    hashTarget.SetCompact(pblock->nBits);
+                if (header.nTime != pwork->nTime || header.nBits != pwork->nBits) {
+                    // Changing nTime can change work required on testnet
+                    std::shared_ptr<CMinerWork> pworkNew = std::make_shared<CMinerWork>(*pwork);
+                    pworkNew->nTime = header.nTime;
+                    pworkNew->nBits = header.nBits;
+                    PublishMinerWork(pworkNew);
+                    pwork = pworkNew;
                 }
             }
+            PublishMinerWork(NULL);
         }
     }
     catch (const boost::thread_interrupted&)
     {
+        PublishMinerWork(NULL);
         LogPrintf("GeekCashMiner -- terminated\n");
         throw;
     }
     catch (const std::runtime_error &e)
     {
         LogPrintf("GeekCashMiner -- runtime error: %s\n", e.what());
-        return;
+    }
+    PublishMinerWork(NULL);
+    fMinerStop = true;
+}
+
+static void MinerWorker(int nWorker, int nWorkers, const CChainParams& chainparams)
+{
+    RenameThread(strprintf("geekcash-miner-%d", nWorker).c_str());
+    SetThreadPriority(THREAD_PRIORITY_LOWEST);
+
+    std::shared_ptr<const CMinerWork> pwork;
+    uint64_t nGeneration = 0;
+    unsigned int nRound = 0;
+    CMutableTransaction txCoinbase;
+    CBlockHeader header;
+    arith_uint256 hashTarget;
+
+    // Consecutive nonces are hashed together, so HashGeekBatch can run them
+    // through its multi-way kernels. Only the trailing nonce differs between
+    // the copies of the header.
+    const size_t nHeaderSize = CBlockHeader::HEADER_SIZE;
+    unsigned char vchHeaders[MINER_HASH_BATCH * CBlockHeader::HEADER_SIZE];
+    uint256 hashes[MINER_HASH_BATCH];
+
+    int64_t nStatsStart = GetTimeMillis();
+    uint64_t nStatsHashes = 0;
+
+    try {
+        while (!fMinerStop) {
+            boost::this_thread::interruption_point();
+
+            if (nGeneration != nMinerWorkGeneration) {
+                std::shared_ptr<const CMinerWork> pworkPrev = pwork;
+                {
+                    LOCK(cs_minerWork);
+                    pwork = pminerWork;
+                    nGeneration = nMinerWorkGeneration;
+                }
+                if (!pwork)
+                    continue;
+                // A new template starts the extranonces over; a time update
+                // moves on to this worker's next one.
+                if (!pworkPrev || pworkPrev->pblocktemplate != pwork->pblocktemplate)
+                    nRound = 0;
+                header.nNonce = std::numeric_limits<uint32_t>::max();
+            }
+            if (!pwork) {
+                MilliSleep(100);
+                continue;
+            }
+
+            if (header.nNonce >= 0xffff0000) {
+                // Move to this worker's next extranonce and rebuild the header
+                const CBlockTemplate& blocktemplate = *pwork->pblocktemplate;
+                unsigned int nExtraNonce = nRound * nWorkers + nWorker + 1;
+                nRound++;
+                txCoinbase = CMutableTransaction(*blocktemplate.block.vtx[0]);
+                SetCoinbaseExtraNonce(txCoinbase, pwork->pindexPrev, nExtraNonce);
+                header = blocktemplate.block.GetBlockHeader();
+                header.hashMerkleRoot = ComputeMerkleRootFromBranch(txCoinbase.GetHash(), blocktemplate.vCoinbaseBranch, 0);
+                header.nTime = pwork->nTime;
+                header.nBits = pwork->nBits;
+                header.nNonce = 0;
+                hashTarget.SetCompact(header.nBits);
+                for (unsigned int i = 0; i < MINER_HASH_BATCH; i++)
+                    memcpy(vchHeaders + i * nHeaderSize, BEGIN(header.nVersion), nHeaderSize);
+            }
+
+            //
+            // Search
+            //
+            uint32_t nNonceEnd = header.nNonce + MINER_NONCE_CHUNK;
+            unsigned int nFound = MINER_HASH_BATCH;
+            while (header.nNonce != nNonceEnd)
+            {
+                for (unsigned int i = 0; i < MINER_HASH_BATCH; i++) {
+                    uint32_t nNonce = header.nNonce + i;
+                    memcpy(vchHeaders + (i + 1) * nHeaderSize - sizeof(nNonce), &nNonce, sizeof(nNonce));
+                }
+                HashGeekBatch(vchHeaders, nHeaderSize, MINER_HASH_BATCH, hashes);
+                nStatsHashes += MINER_HASH_BATCH;
+
+                for (unsigned int i = 0; i < MINER_HASH_BATCH && nFound == MINER_HASH_BATCH; i++) {
+                    if (UintToArith256(hashes[i]) <= hashTarget)
+                        nFound = i;
+                }
+                if (nFound < MINER_HASH_BATCH)
+                    break;
+                header.nNonce += MINER_HASH_BATCH;
+            }
+
+            if (nFound < MINER_HASH_BATCH)
+            {
+                // Found a solution
+                LOCK(cs_minerSubmit);
+                CBlock block = pwork->pblocktemplate->block;
+                block.vtx[0] = MakeTransactionRef(txCoinbase);
+                block.hashMerkleRoot = header.hashMerkleRoot;
+                block.nTime = header.nTime;
+                block.nBits = header.nBits;
+                block.nNonce = header.nNonce + nFound;
+                // Memoized, so a found block is not hashed again downstream
+                uint256 hash = block.CacheHash();
+                SetThreadPriority(THREAD_PRIORITY_NORMAL);
+                LogPrintf("GeekCashMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
+                ProcessBlockFound(&block, chainparams);
+                SetThreadPriority(THREAD_PRIORITY_LOWEST);
+                pwork->coinbaseScript->KeepScript();
+
+                // In regression test mode, stop mining after a block is found. This
+                // allows developers to controllably generate a block on demand.
+                if (chainparams.MineBlocksOnDemand())
+                    fMinerStop = true;
+
+                // Idle until the control thread publishes work on the new tip
+                header.nNonce = std::numeric_limits<uint32_t>::max();
+                pwork.reset();
+            }
+
+            int64_t nNow = GetTimeMillis();
+            if (nNow - nStatsStart >= MINER_STATS_INTERVAL) {
+                LOCK(cs_minerStats);
+                vMinerHashesPerSec[nWorker] = 1000.0 * nStatsHashes / (nNow - nStatsStart);
+                nStatsStart = nNow;
+                nStatsHashes = 0;
+            }
+        }
+    }
+    catch (const boost::thread_interrupted&)
+    {
+        LogPrint("miner", "GeekCashMiner -- worker %d terminated\n", nWorker);
+        throw;
     }
 }
 
@@ -532,14 +713,37 @@ void GenerateBitcoins(bool fGenerate, int nThreads, const CChainParams& chainpar
     if (minerThreads != NULL)
     {
         minerThreads->interrupt_all();
+        minerThreads->join_all();
         delete minerThreads;
         minerThreads = NULL;
     }
+    PublishMinerWork(NULL);
+    fMinerStop = false;
+    {
+        LOCK(cs_minerStats);
+        vMinerHashesPerSec.assign(fGenerate ? std::max(nThreads, 0) : 0, 0.0);
+    }
 
     if (nThreads == 0 || !fGenerate)
         return;
 
     minerThreads = new boost::thread_group();
+    minerThreads->create_thread(boost::bind(&MinerControl, boost::cref(chainparams), boost::ref(connman)));
     for (int i = 0; i < nThreads; i++)
-        minerThreads->create_thread(boost::bind(&BitcoinMiner, boost::cref(chainparams), boost::ref(connman)));
+        minerThreads->create_thread(boost::bind(&MinerWorker, i, nThreads, boost::cref(chainparams)));
+}
+
+std::vector<double> GetMinerThreadHashesPerSec()
+{
+    LOCK(cs_minerStats);
+    return vMinerHashesPerSec;
+}
+
+double GetMinerHashesPerSec()
+{
+    LOCK(cs_minerStats);
+    double dHashesPerSec = 0;
+    BOOST_FOREACH(double dRate, vMinerHashesPerSec)
+        dHashesPerSec += dRate;
+    return dHashesPerSec;
 }
@@ -20,6 +20,8 @@ namespace Consensus { struct Params; };
 
 static const bool DEFAULT_GENERATE = false;
 static const int DEFAULT_GENERATE_THREADS = 1;
+/** Number of consecutive nonces the miner hashes in one HashGeekBatch call */
+static const unsigned int MINER_HASH_BATCH = 4;
 
 static const bool DEFAULT_PRINTPRIORITY = false;
 
@@ -28,14 +30,26 @@ struct CBlockTemplate
     CBlock block;
     std::vector<CAmount> vTxFees;
     std::vector<int64_t> vTxSigOps;
+    /** Merkle branch of the coinbase (position 0), to re-derive the root when only the coinbase changes */
+    std::vector<uint256> vCoinbaseBranch;
 };
 
-/** Run the miner threads */
+/** Run the miner threads: one control thread and nThreads workers sharing its template */
 void GenerateBitcoins(bool fGenerate, int nThreads, const CChainParams& chainparams, CConnman& connman);
+/** Hash rate of each miner worker thread, in hashes per second; empty when not mining */
+std::vector<double> GetMinerThreadHashesPerSec();
+/** Total hash rate of the miner worker threads, in hashes per second */
+double GetMinerHashesPerSec();
 /** Generate a new block, without valid proof-of-work */
 CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& scriptPubKeyIn);
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
+/**
+ * Modify the extranonce in a template's block, updating the merkle root from
+ * the cached coinbase branch in O(log n) hashes. The other transactions must
+ * not have changed since CreateNewBlock.
+ */
+void IncrementExtraNonce(CBlockTemplate* pblocktemplate, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
 
 #endif // BITCOIN_MINER_H
@@ -10,13 +10,66 @@
 #include "utilstrencodings.h"
 #include "crypto/common.h"
 
+std::atomic<uint64_t> CBlockHeader::nHashCacheHits(0);
+
+bool CBlockHeader::IsHashCached() const
+{
+    return fHashCached && memcmp(vchHashedHeader, BEGIN(nVersion), HEADER_SIZE) == 0;
+}
+
 uint256 CBlockHeader::GetHash() const
 {
+    if (IsHashCached()) {
+        nHashCacheHits.fetch_add(1, std::memory_order_relaxed);
+        return hashCached;
+    }
     //return HashX11(BEGIN(nVersion), END(nNonce));
     //return HashKeccak(BEGIN(nVersion), END(nNonce));
     return HashGeek(BEGIN(nVersion), END(nNonce));
 }
 
+uint256 CBlockHeader::CacheHash() const
+{
+    if (IsHashCached()) {
+        nHashCacheHits.fetch_add(1, std::memory_order_relaxed);
+        return hashCached;
+    }
+    hashCached = HashGeek(BEGIN(nVersion), END(nNonce));
+    memcpy(vchHashedHeader, BEGIN(nVersion), HEADER_SIZE);
+    fHashCached = true;
+    return hashCached;
+}
+
+void CBlockHeader::CacheHashes(const CBlockHeader* headers, size_t count)
+{
+    std::vector<uint256> hashes(count);
+    HashGeekBatch(headers, count, hashes.data());
+    for (size_t i = 0; i < count; i++) {
+        const CBlockHeader& header = headers[i];
+        header.hashCached = hashes[i];
+        memcpy(header.vchHashedHeader, BEGIN(header.nVersion), HEADER_SIZE);
+        header.fHashCached = true;
+    }
+}
+
+uint64_t CBlockHeader::GetHashCacheHits()
+{
+    return nHashCacheHits.load(std::memory_order_relaxed);
+}
+
+void HashGeekBatch(const CBlockHeader* headers, size_t count, uint256* out)
+{
+    const size_t size = CBlockHeader::HEADER_SIZE;
+    std::vector<unsigned char> buf(count * size);
+    for (size_t i = 0; i < count; i++) {
+        // Same byte range as hashed by CBlockHeader::GetHash()
+        memcpy(&buf[i * size], BEGIN(headers[i].nVersion), size);
+    }
+    if (count > 0) {
+        HashGeekBatch(&buf[0], size, count, out);
+    }
+}
+
 std::string CBlock::ToString() const
 {
     std::stringstream s;
@@ -29,7 +82,7 @@ std::string CBlock::ToString() const
         vtx.size());
     for (unsigned int i = 0; i < vtx.size(); i++)
     {
-        s << "  " << vtx[i].ToString() << "\n";
+        s << "  " << vtx[i]->ToString() << "\n";
     }
     return s.str();
 }
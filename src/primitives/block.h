@@ -10,6 +10,8 @@
 #include "serialize.h"
 #include "uint256.h"
 
+#include <atomic>
+
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
  * requirements.  When they solve the proof-of-work, they broadcast the block
@@ -28,6 +30,9 @@ public:
     uint32_t nBits;
     uint32_t nNonce;
 
+    /** Size of the serialized header, which is what GetHash() hashes */
+    static const size_t HEADER_SIZE = 80;
+
     CBlockHeader()
     {
         SetNull();
@@ -54,6 +59,7 @@ public:
         nTime = 0;
         nBits = 0;
         nNonce = 0;
+        fHashCached = false;
     }
 
     bool IsNull() const
@@ -63,10 +69,36 @@ public:
 
     uint256 GetHash() const;
 
+    /**
+     * Compute the block hash and memoize it, so later GetHash() calls on the
+     * same header do not run HashGeek again. Changing any header field
+     * invalidates the memoized hash. The memo is not synchronized: only call
+     * this while no other thread can access the header, e.g. right after
+     * deserializing it.
+     */
+    uint256 CacheHash() const;
+
+    /** CacheHash() for a range of headers, hashing them in batches */
+    static void CacheHashes(const CBlockHeader* headers, size_t count);
+
+    /** Number of HashGeek evaluations avoided thanks to memoized hashes */
+    static uint64_t GetHashCacheHits();
+
+    /** Whether the memoized hash is present and matches the current fields */
+    bool IsHashCached() const;
+
     int64_t GetBlockTime() const
     {
         return (int64_t)nTime;
     }
+
+private:
+    // memory only
+    mutable bool fHashCached;
+    mutable unsigned char vchHashedHeader[HEADER_SIZE];
+    mutable uint256 hashCached;
+
+    static std::atomic<uint64_t> nHashCacheHits;
 };
 
 
@@ -74,7 +106,7 @@ class CBlock : public CBlockHeader
 {
 public:
     // network and disk
-    std::vector<CTransaction> vtx;
+    std::vector<CTransactionRef> vtx;
 
     // memory only
     mutable CTxOut txoutMasternode; // masternode payment
@@ -111,20 +143,21 @@ public:
 
     CBlockHeader GetBlockHeader() const
     {
-        CBlockHeader block;
-        block.nVersion       = nVersion;
-        block.hashPrevBlock  = hashPrevBlock;
-        block.hashMerkleRoot = hashMerkleRoot;
-        block.nTime          = nTime;
-        block.nBits          = nBits;
-        block.nNonce         = nNonce;
-        return block;
+        // Plain copy, which keeps a memoized hash
+        return *this;
     }
 
     std::string ToString() const;
 };
 
 
+/** Compute the hashes of count block headers at once. This gives the same
+ * results as calling GetHash() on each header, but is faster on CPUs where
+ * HashGeekBatch can hash several headers in parallel.
+ */
+void HashGeekBatch(const CBlockHeader* headers, size_t count, uint256* out);
+
+
 /** Describes a place in the block chain to another node such that if the
  * other node doesn't have the same branch, it can find a recent common trunk.
  * The further back it is, the further before the fork it may be.
@@ -2,13 +2,19 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "chainparams.h"
 #include "hash.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "streams.h"
 #include "utilstrencodings.h"
 #include "test/test_geekcash.h"
 
+#include <atomic>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
 
 using namespace std;
 
@@ -85,4 +91,135 @@ BOOST_AUTO_TEST_CASE(siphash)
     }*/
 }
 
+BOOST_AUTO_TEST_CASE(hashgeek_hasher)
+{
+    std::vector<std::vector<unsigned char> > inputs(64);
+    std::vector<uint256> expected(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        inputs[i].resize(1 + insecure_rand() % 200);
+        for (size_t j = 0; j < inputs[i].size(); j++) {
+            inputs[i][j] = insecure_rand();
+        }
+        expected[i] = HashGeek(inputs[i].begin(), inputs[i].end());
+    }
+    BOOST_CHECK(HashGeek(BEGIN(Params().GenesisBlock().nVersion), END(Params().GenesisBlock().nNonce)) == Params().GetConsensus().hashGenesisBlock);
+
+    // One hasher reused across inputs starts each hash from scratch.
+    CHashGeek hasher;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        BOOST_CHECK(hasher.Hash(&inputs[i][0], inputs[i].size()) == expected[i]);
+    }
+
+    // Threads hashing at the same time each use their own hasher.
+    std::atomic<int> mismatches(0);
+    boost::thread_group threads;
+    for (int t = 0; t < 4; t++) {
+        threads.create_thread([&inputs, &expected, &mismatches]() {
+            for (int round = 0; round < 20; round++) {
+                for (size_t i = 0; i < inputs.size(); i++) {
+                    if (HashGeek(inputs[i].begin(), inputs[i].end()) != expected[i]) mismatches++;
+                }
+            }
+        });
+    }
+    threads.join_all();
+    BOOST_CHECK_EQUAL(mismatches, 0);
+}
+
+BOOST_AUTO_TEST_CASE(hashgeek_batch)
+{
+    // Raw inputs, covering lengths that fit a single BLAKE-512 block and
+    // lengths that do not.
+    const size_t lengths[] = {0, 1, 64, 80, 111, 112, 200};
+    for (size_t len : lengths) {
+        for (size_t count = 0; count <= 9; count++) {
+            std::vector<unsigned char> in(len * count + 1);
+            for (size_t i = 0; i < in.size(); i++) {
+                in[i] = insecure_rand();
+            }
+            std::vector<uint256> out(count + 1);
+            out[count] = uint256S("1234");
+            HashGeekBatch(&in[0], len, count, &out[0]);
+            for (size_t i = 0; i < count; i++) {
+                BOOST_CHECK(out[i] == HashGeek(in.begin() + i * len, in.begin() + (i + 1) * len));
+            }
+            // Nothing past the requested outputs may be touched
+            BOOST_CHECK(out[count] == uint256S("1234"));
+        }
+    }
+
+    // Block headers
+    std::vector<CBlockHeader> headers(11);
+    headers[0] = Params().GenesisBlock().GetBlockHeader();
+    for (size_t i = 1; i < headers.size(); i++) {
+        headers[i].nVersion = insecure_rand();
+        headers[i].hashPrevBlock = GetRandHash();
+        headers[i].hashMerkleRoot = GetRandHash();
+        headers[i].nTime = insecure_rand();
+        headers[i].nBits = insecure_rand();
+        headers[i].nNonce = insecure_rand();
+    }
+    std::vector<uint256> hashes(headers.size());
+    HashGeekBatch(&headers[0], headers.size(), &hashes[0]);
+    BOOST_CHECK(hashes[0] == Params().GetConsensus().hashGenesisBlock);
+    for (size_t i = 0; i < headers.size(); i++) {
+        BOOST_CHECK(hashes[i] == headers[i].GetHash());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(blockheader_hash_cache)
+{
+    CBlockHeader header = Params().GenesisBlock().GetBlockHeader();
+    const uint256 hash = header.GetHash();
+
+    // Without CacheHash() nothing is memoized
+    uint64_t hits = CBlockHeader::GetHashCacheHits();
+    BOOST_CHECK(header.GetHash() == hash);
+    BOOST_CHECK_EQUAL(CBlockHeader::GetHashCacheHits(), hits);
+
+    BOOST_CHECK(header.CacheHash() == hash);
+    BOOST_CHECK(header.GetHash() == hash);
+    BOOST_CHECK_EQUAL(CBlockHeader::GetHashCacheHits(), hits + 1);
+
+    // Copies keep the memoized hash
+    CBlock block(header);
+    BOOST_CHECK(block.GetHash() == hash);
+    BOOST_CHECK(block.GetBlockHeader().GetHash() == hash);
+    BOOST_CHECK_EQUAL(CBlockHeader::GetHashCacheHits(), hits + 3);
+
+    // Any change to the header invalidates it
+    header.nNonce++;
+    const uint256 hashMutated = header.GetHash();
+    BOOST_CHECK(hashMutated != hash);
+    BOOST_CHECK(hashMutated == HashGeek(BEGIN(header.nVersion), END(header.nNonce)));
+    header.nNonce--;
+    BOOST_CHECK(header.GetHash() == hash);
+    header.hashMerkleRoot = GetRandHash();
+    BOOST_CHECK(header.GetHash() != hash);
+    header.SetNull();
+    BOOST_CHECK(header.GetHash() == HashGeek(BEGIN(header.nVersion), END(header.nNonce)));
+
+    // Deserializing over a memoized header must not return the old hash
+    CBlockHeader other = Params().GenesisBlock().GetBlockHeader();
+    other.CacheHash();
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << header;
+    ss >> other;
+    BOOST_CHECK(other.GetHash() == header.GetHash());
+
+    // Batched memoization gives the same result as hashing one by one
+    std::vector<CBlockHeader> headers(7);
+    for (size_t i = 0; i < headers.size(); i++) {
+        headers[i].nVersion = insecure_rand();
+        headers[i].hashPrevBlock = GetRandHash();
+        headers[i].nNonce = insecure_rand();
+    }
+    CBlockHeader::CacheHashes(headers.data(), headers.size());
+    hits = CBlockHeader::GetHashCacheHits();
+    for (size_t i = 0; i < headers.size(); i++) {
+        BOOST_CHECK(headers[i].GetHash() == HashGeek(BEGIN(headers[i].nVersion), END(headers[i].nNonce)));
+    }
+    BOOST_CHECK_EQUAL(CBlockHeader::GetHashCacheHits(), hits + headers.size());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chainparams.h"
+#include "consensus/validation.h"
 #include "validation.h"
 #include "net.h"
 
@@ -80,4 +81,32 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+
+BOOST_AUTO_TEST_CASE(check_block_headers_pow)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    const CBlockHeader genesis = Params().GenesisBlock().GetBlockHeader();
+
+    // Enough headers to be spread over the header checking threads
+    std::vector<CBlockHeader> headers(100, genesis);
+    CValidationState state;
+    BOOST_CHECK(CheckBlockHeadersPoW(headers, state, consensusParams));
+    BOOST_CHECK(state.IsValid());
+    for (const CBlockHeader& header : headers) {
+        BOOST_CHECK(header.IsHashCached());
+        BOOST_CHECK(header.GetHash() == consensusParams.hashGenesisBlock);
+    }
+
+    // A single header with too little work fails the whole batch
+    headers[77].nNonce += 1;
+    BOOST_CHECK(!CheckBlockHeadersPoW(headers, state, consensusParams));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "high-hash");
+
+    headers.resize(1);
+    CValidationState stateSingle;
+    BOOST_CHECK(CheckBlockHeadersPoW(headers, stateSingle, consensusParams));
+    headers.clear();
+    BOOST_CHECK(CheckBlockHeadersPoW(headers, stateSingle, consensusParams));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
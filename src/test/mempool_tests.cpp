@@ -4,6 +4,7 @@
 
 #include "txmempool.h"
 #include "util.h"
+#include "validation.h"
 
 #include "test/test_geekcash.h"
 
@@ -443,7 +444,7 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     pool.addUnchecked(tx5.GetHash(), entry.Fee(1000LL).FromTx(tx5, &pool));
     pool.addUnchecked(tx7.GetHash(), entry.Fee(9000LL).FromTx(tx7, &pool));
 
-    std::vector<CTransaction> vtx;
+    std::vector<CTransactionRef> vtx;
     std::list<CTransaction> conflicts;
     SetMockTime(42);
     SetMockTime(42 + CTxMemPool::ROLLING_FEE_HALFLIFE);
@@ -473,4 +474,64 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolInfoAllTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+
+    // A chain of transactions, whose txids are in no particular order
+    std::vector<CMutableTransaction> chain(5);
+    for (unsigned int i = 0; i < chain.size(); i++) {
+        chain[i].vin.resize(1);
+        chain[i].vin[0].scriptSig = CScript() << OP_11;
+        if (i > 0)
+            chain[i].vin[0].prevout = COutPoint(chain[i - 1].GetHash(), 0);
+        chain[i].vout.resize(1);
+        chain[i].vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        chain[i].vout[0].nValue = 10000LL - i;
+        pool.addUnchecked(chain[i].GetHash(), entry.Time(100 + i).FromTx(chain[i], &pool));
+    }
+
+    // Every transaction comes after its parents, with its entry time
+    std::vector<TxMempoolInfo> vinfo = pool.infoAll();
+    BOOST_CHECK_EQUAL(vinfo.size(), chain.size());
+    for (unsigned int i = 0; i < vinfo.size(); i++) {
+        BOOST_CHECK(vinfo[i].tx->GetHash() == chain[i].GetHash());
+        BOOST_CHECK_EQUAL(vinfo[i].nTime, 100 + i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MempoolPersistTest)
+{
+    TestMemPoolEntryHelper entry;
+
+    // Spends an output that does not exist, so it does not validate on load
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << OP_11;
+    tx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    tx.vout.resize(1);
+    tx.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx.vout[0].nValue = 10000LL;
+    mempool.addUnchecked(tx.GetHash(), entry.Time(GetTime()).FromTx(tx));
+
+    uint256 hashPrioritised = GetRandHash();
+    mempool.PrioritiseTransaction(hashPrioritised, hashPrioritised.ToString(), 1.5, 4000);
+
+    BOOST_CHECK(DumpMempool());
+    mempool.clear();
+    mempool.ClearPrioritisation(hashPrioritised);
+
+    BOOST_CHECK(LoadMempool());
+    BOOST_CHECK_EQUAL(mempool.size(), 0);
+
+    // The fee deltas are restored
+    double dPriorityDelta = 0;
+    CAmount nFeeDelta = 0;
+    mempool.ApplyDeltas(hashPrioritised, dPriorityDelta, nFeeDelta);
+    BOOST_CHECK_EQUAL(dPriorityDelta, 1.5);
+    BOOST_CHECK_EQUAL(nFeeDelta, 4000);
+    mempool.ClearPrioritisation(hashPrioritised);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -15,8 +15,8 @@ static uint256 BlockBuildMerkleTree(const CBlock& block, bool* fMutated, std::ve
 {
     vMerkleTree.clear();
     vMerkleTree.reserve(block.vtx.size() * 2 + 16); // Safe upper bound for the number of total nodes.
-    for (std::vector<CTransaction>::const_iterator it(block.vtx.begin()); it != block.vtx.end(); ++it)
-        vMerkleTree.push_back(it->GetHash());
+    for (std::vector<CTransactionRef>::const_iterator it(block.vtx.begin()); it != block.vtx.end(); ++it)
+        vMerkleTree.push_back((*it)->GetHash());
     int j = 0;
     bool mutated = false;
     for (int nSize = block.vtx.size(); nSize > 1; nSize = (nSize + 1) / 2)
@@ -86,7 +86,7 @@ BOOST_AUTO_TEST_CASE(merkle_test)
             for (int j = 0; j < ntx; j++) {
                 CMutableTransaction mtx;
                 mtx.nLockTime = j;
-                block.vtx[j] = mtx;
+                block.vtx[j] = MakeTransactionRef(std::move(mtx));
             }
             // Compute the root of the block before mutating it.
             bool unmutatedMutated = false;
@@ -115,6 +115,17 @@ BOOST_AUTO_TEST_CASE(merkle_test)
             BOOST_CHECK((newRoot == uint256()) == (ntx == 0));
             BOOST_CHECK(oldMutated == newMutated);
             BOOST_CHECK(newMutated == !!mutate);
+            // Every level of the tree, as the old mechanism laid it out in merkleTree.
+            std::vector<uint256> leaves;
+            for (size_t j = 0; j < block.vtx.size(); j++) {
+                leaves.push_back(block.vtx[j]->GetHash());
+            }
+            std::vector<std::vector<uint256> > levels = ComputeMerkleLevels(leaves);
+            std::vector<uint256> flatLevels;
+            for (size_t j = 0; j < levels.size(); j++) {
+                flatLevels.insert(flatLevels.end(), levels[j].begin(), levels[j].end());
+            }
+            BOOST_CHECK(flatLevels == merkleTree);
             // If no mutation was done (once for every ntx value), try up to 16 branches.
             if (mutate == 0) {
                 for (int loop = 0; loop < std::min(ntx, 16); loop++) {
@@ -126,7 +137,13 @@ BOOST_AUTO_TEST_CASE(merkle_test)
                     std::vector<uint256> newBranch = BlockMerkleBranch(block, mtx);
                     std::vector<uint256> oldBranch = BlockGetMerkleBranch(block, merkleTree, mtx);
                     BOOST_CHECK(oldBranch == newBranch);
-                    BOOST_CHECK(ComputeMerkleRootFromBranch(block.vtx[mtx].GetHash(), newBranch, mtx) == oldRoot);
+                    BOOST_CHECK(ComputeMerkleRootFromBranch(block.vtx[mtx]->GetHash(), newBranch, mtx) == oldRoot);
+                    // The root and the branch computed in one pass match both.
+                    std::vector<uint256> passBranch;
+                    bool passMutated = true;
+                    BOOST_CHECK(BlockMerkleRootAndBranch(block, mtx, passBranch, &passMutated) == oldRoot);
+                    BOOST_CHECK(passBranch == oldBranch);
+                    BOOST_CHECK(!passMutated);
                 }
             }
         }
@@ -104,17 +104,17 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
         CBlock *pblock = &pblocktemplate->block; // pointer for convenience
         pblock->nVersion = 1;
         pblock->nTime = chainActive.Tip()->GetMedianTimePast()+1;
-        CMutableTransaction txCoinbase(pblock->vtx[0]);
+        CMutableTransaction txCoinbase(*pblock->vtx[0]);
         txCoinbase.nVersion = 1;
         txCoinbase.vin[0].scriptSig = CScript();
         txCoinbase.vin[0].scriptSig.push_back(blockinfo[i].extranonce);
         txCoinbase.vin[0].scriptSig.push_back(chainActive.Height());
         txCoinbase.vout[0].scriptPubKey = CScript();
-        pblock->vtx[0] = CTransaction(txCoinbase);
+        pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
         if (txFirst.size() == 0)
             baseheight = chainActive.Height();
         if (txFirst.size() < 4)
-            txFirst.push_back(new CTransaction(pblock->vtx[0]));
+            txFirst.push_back(new CTransaction(*pblock->vtx[0]));
         pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
         pblock->nNonce = blockinfo[i].nonce;
         BOOST_CHECK(ProcessNewBlock(chainparams, pblock, true, NULL, NULL));
@@ -388,4 +388,33 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     fCheckpointsEnabled = true;
 }
 
+BOOST_AUTO_TEST_CASE(IncrementExtraNonce_coinbase_branch)
+{
+    const CChainParams& chainparams = Params(CBaseChainParams::MAIN);
+    CScript scriptPubKey = CScript() << OP_TRUE;
+    std::unique_ptr<CBlockTemplate> pblocktemplate(CreateNewBlock(chainparams, scriptPubKey));
+    BOOST_CHECK(pblocktemplate.get());
+    CBlock& block = pblocktemplate->block;
+    BOOST_CHECK(block.hashMerkleRoot == BlockMerkleRoot(block));
+    BOOST_CHECK(pblocktemplate->vCoinbaseBranch == BlockMerkleBranch(block, 0));
+
+    // Grow the template to several tree levels, refreshing the branch as
+    // CreateNewBlock would have.
+    for (int i = 0; i < 37; i++) {
+        CMutableTransaction tx;
+        tx.nLockTime = i;
+        block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+    }
+    pblocktemplate->vCoinbaseBranch = BlockMerkleBranch(block, 0);
+
+    // Rolling the extranonce through the cached branch gives the full root.
+    unsigned int nExtraNonce = 0;
+    for (int i = 0; i < 3; i++) {
+        uint256 hashOldRoot = block.hashMerkleRoot;
+        IncrementExtraNonce(pblocktemplate.get(), chainActive.Tip(), nExtraNonce);
+        BOOST_CHECK(block.hashMerkleRoot != hashOldRoot);
+        BOOST_CHECK(block.hashMerkleRoot == BlockMerkleRoot(block));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()